@@ -1,61 +1,144 @@
 #include <cpgen/cli_interface.h>
 #include <cpgen/template_manager.h>
+#include <cpgen/trace.h>
 
 #include <fmt/format.h>
 
-int main(int argc, char** argv) {
-    cpgen::CliInterface cli{argc, argv};
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
 
-    cpgen::TemplateManager template_manager;
+namespace {
 
-    if (cli.options().update) {
-        template_manager.update();
+// Records how long each step takes, printed at exit with --timings
+class Timings {
+public:
+    using clock = std::chrono::steady_clock;
+
+    Timings() : start_{clock::now()}, last_{start_} {
     }
 
-    if (cli.project().has_value()) {
-        template_manager.createProject(cli.project().value());
+    void step(std::string name) {
+        const auto now = clock::now();
+        steps_.emplace_back(std::move(name), now - last_);
+        last_ = now;
     }
 
-    if (not cli.libraries().empty() or not cli.executables().empty() or
-        not cli.tests().empty()) {
-        namespace fs = std::filesystem;
+    // Components are rendered in parallel so they are reported separately,
+    // with the time spent on each of them summed over all the threads
+    void component(const cpgen::ComponentTiming& timing) {
+        components_.push_back(timing);
+    }
+
+    void print() const {
+        for (const auto& [name, duration] : steps_) {
+            fmt::print(stderr, "{:<40} {:>10.3f}ms\n", name, to_ms(duration));
+        }
+        for (const auto& component : components_) {
+            fmt::print(stderr, "  {:<38} {:>10.3f}ms {:>6} files\n",
+                       component.name, to_ms(component.render_time),
+                       component.files);
+        }
+        fmt::print(stderr, "{:<40} {:>10.3f}ms\n", "total",
+                   to_ms(last_ - start_));
+    }
+
+private:
+    template <typename Duration> static double to_ms(Duration duration) {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+
+    clock::time_point start_;
+    clock::time_point last_;
+    std::vector<std::pair<std::string, clock::duration>> steps_;
+    std::vector<cpgen::ComponentTiming> components_;
+};
+
+std::filesystem::path find_project_root() {
+    namespace fs = std::filesystem;
+    auto current_dir = fs::current_path();
+
+    do {
+        if (fs::exists(current_dir / ".cpgen")) {
+            break;
+        } else {
+            current_dir = current_dir.parent_path();
+        }
+    } while (current_dir != current_dir.root_directory());
+
+    if (current_dir.parent_path() == current_dir) {
+        throw std::runtime_error("Failed to locate a CPGen project root");
+    }
 
-        auto find_project_root = [] {
-            auto current_dir = fs::current_path();
+    fmt::print("Project root path {}\n", current_dir.native());
 
-            do {
-                if (fs::exists(current_dir / ".cpgen")) {
-                    break;
-                } else {
-                    current_dir = current_dir.parent_path();
-                }
-            } while (current_dir != current_dir.root_directory());
+    return current_dir;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Timings timings;
+
+    const auto parsing_start = cpgen::Tracer::clock::now();
+    cpgen::CliInterface cli{argc, argv};
 
-            if (current_dir.parent_path() == current_dir) {
-                throw std::runtime_error(
-                    "Failed to locate a CPGen project root");
-            }
+    // Declared before the TemplateManager so that it is destroyed after it
+    std::unique_ptr<cpgen::Tracer> tracer;
+    if (not cli.options().trace_file.empty()) {
+        tracer = std::make_unique<cpgen::Tracer>(cli.options().trace_file);
+        tracer->addSpan("cli", "parse command line", parsing_start,
+                        cpgen::Tracer::clock::now());
+    }
 
-            fmt::print("Project root path {}\n", current_dir.native());
+    cpgen::TemplateManager template_manager{cli.options().generation};
 
-            return current_dir;
-        };
+    // Cold starts (templates not downloaded yet, index to rebuild) show up in
+    // the first generation step since templates are loaded lazily
+    timings.step("startup");
 
-        auto project_root = cli.project().has_value()
-                                ? fs::path(cli.project()->root_path) /
-                                      fs::path(cli.project()->name)
+    if (cli.options().update) {
+        template_manager.update();
+        timings.step("update");
+    }
+
+    const auto batch =
+        cpgen::BatchParameters{cli.project(), cli.libraries(),
+                               cli.executables(), cli.tests(),
+                               cli.benchmarks()};
+
+    if (batch.project or not batch.libraries.empty() or
+        not batch.executables.empty() or not batch.tests.empty() or
+        not batch.benchmarks.empty()) {
+        namespace fs = std::filesystem;
+
+        auto project_root = batch.project.has_value()
+                                ? fs::path(batch.project->root_path) /
+                                      fs::path(batch.project->name)
                                 : find_project_root();
 
-        for (auto& library : cli.libraries()) {
-            template_manager.createLibrary(library, project_root);
+        cpgen::TraceSpan span{"generation", "generation"};
+        for (const auto& component :
+             template_manager.createBatch(batch, project_root)) {
+            timings.component(component);
         }
+        timings.step("generation");
+    }
 
-        for (auto& executable : cli.executables()) {
-            template_manager.createExecutable(executable, project_root);
-        }
+    bool upgraded{true};
+    if (cli.options().upgrade) {
+        upgraded = template_manager.upgrade(find_project_root());
+        timings.step("upgrade");
+    }
 
-        for (auto& test : cli.tests()) {
-            template_manager.createTest(test, project_root);
-        }
+    if (cli.options().timings) {
+        timings.print();
     }
+
+    return upgraded ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -0,0 +1,29 @@
+#include <benchmark/benchmark.h>
+#include <fmt/format.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <unistd.h>
+
+// The TemplateManager benchmarks use the templates from this repository,
+// copied to a temporary HOME so that the user's ones are left untouched
+int main(int argc, char** argv) {
+    namespace fs = std::filesystem;
+
+    const auto home = fs::temp_directory_path() /
+                      fmt::format("cpgen_bench.{}", getpid());
+    fs::create_directories(home / ".cpgen");
+    fs::copy(CPGEN_TEMPLATES_DIR, home / ".cpgen" / "templates",
+             fs::copy_options::recursive);
+    setenv("HOME", home.c_str(), 1);
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        fs::remove_all(home);
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+
+    fs::remove_all(home);
+}
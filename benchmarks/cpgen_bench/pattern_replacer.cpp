@@ -0,0 +1,138 @@
+#include "pattern_replacer.h"
+
+#include <benchmark/benchmark.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Keys used in the actual templates
+const auto dictionnary = std::map<std::string, std::string>{
+    {"component_name", "my_component"},
+    {"component_std", "17"},
+    {"component_type", "STATIC"},
+    {"component_dependencies", "CONAN_PKG::fmt\n\t\tThreads::Threads"},
+    {"project_name", "my_project"}};
+
+// Files of the given size made of 32 bytes lines, each KiB holding exactly the
+// given number of placeholders (32 at most) at random lines. Every other
+// placeholder isn't in the dictionnary. The other lines have underscores but
+// never two in a row, so they can't be mistaken for a placeholder
+std::vector<std::string> synthetic_tree(std::size_t file_count,
+                                        std::size_t file_size,
+                                        std::size_t placeholders_per_kib) {
+    constexpr std::size_t lines_per_kib{1024 / 32};
+    const char* keys[] = {"component_name", "unknown_key", "component_std",
+                          "not_a_placeholder", "project_name"};
+
+    std::mt19937 generator{42};
+    std::uniform_int_distribution<std::size_t> key(0, std::size(keys) - 1);
+
+    std::vector<std::string> files(file_count);
+    for (auto& file : files) {
+        file.reserve(file_size + 1024);
+        while (file.size() < file_size) {
+            // Selection sampling of the placeholder lines of this KiB
+            auto remaining = std::min(placeholders_per_kib, lines_per_kib);
+            for (std::size_t line = 0; line < lines_per_kib; line++) {
+                std::uniform_int_distribution<std::size_t> draw(
+                    0, lines_per_kib - line - 1);
+                if (draw(generator) < remaining) {
+                    const auto placeholder =
+                        fmt::format("__{}__", keys[key(generator)]);
+                    file += fmt::format("{:<31}\n", placeholder);
+                    remaining--;
+                } else {
+                    file += "some_code(with_underscores, 0);\n";
+                }
+            }
+        }
+        file.resize(file_size);
+    }
+    return files;
+}
+
+void args(benchmark::internal::Benchmark* benchmark) {
+    benchmark->ArgNames({"files", "size", "density"})
+        ->ArgsProduct(
+            {{1, 16, 256}, {1 << 10, 16 << 10, 256 << 10}, {0, 1, 16}});
+}
+
+// The regex engine is too slow for the largest trees
+void regex_args(benchmark::internal::Benchmark* benchmark) {
+    benchmark->ArgNames({"files", "size", "density"})
+        ->ArgsProduct({{1, 16}, {1 << 10, 16 << 10, 256 << 10}, {0, 1, 16}});
+}
+
+template <cpgen::SubstitutionEngine Engine>
+void BM_PatternReplacer(benchmark::State& state) {
+    const auto files =
+        synthetic_tree(static_cast<std::size_t>(state.range(0)),
+                       static_cast<std::size_t>(state.range(1)),
+                       static_cast<std::size_t>(state.range(2)));
+    const cpgen::PatternReplacer replacer{dictionnary, Engine};
+
+    for (auto _ : state) {
+        for (const auto& file : files) {
+            benchmark::DoNotOptimize(replacer.replace(file));
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0) *
+                            state.range(1));
+}
+
+// Replacement using the placeholders stored in the template index
+void BM_PatternReplacerIndexed(benchmark::State& state) {
+    const auto files =
+        synthetic_tree(static_cast<std::size_t>(state.range(0)),
+                       static_cast<std::size_t>(state.range(1)),
+                       static_cast<std::size_t>(state.range(2)));
+    const cpgen::PatternReplacer replacer{dictionnary,
+                                          cpgen::SubstitutionEngine::Scanner};
+
+    std::vector<std::vector<cpgen::Placeholder>> placeholders;
+    for (const auto& file : files) {
+        placeholders.push_back(cpgen::PatternReplacer::findPlaceholders(file));
+    }
+
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < files.size(); i++) {
+            benchmark::DoNotOptimize(
+                replacer.replace(files[i], placeholders[i]));
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0) *
+                            state.range(1));
+}
+
+void BM_FindPlaceholders(benchmark::State& state) {
+    const auto files =
+        synthetic_tree(static_cast<std::size_t>(state.range(0)),
+                       static_cast<std::size_t>(state.range(1)),
+                       static_cast<std::size_t>(state.range(2)));
+
+    for (auto _ : state) {
+        for (const auto& file : files) {
+            benchmark::DoNotOptimize(
+                cpgen::PatternReplacer::findPlaceholders(file));
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0) *
+                            state.range(1));
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_PatternReplacer, cpgen::SubstitutionEngine::Scanner)
+    ->Apply(args);
+BENCHMARK_TEMPLATE(BM_PatternReplacer, cpgen::SubstitutionEngine::Regex)
+    ->Apply(regex_args);
+BENCHMARK(BM_PatternReplacerIndexed)->Apply(args);
+BENCHMARK(BM_FindPlaceholders)->Apply(args);
@@ -0,0 +1,102 @@
+#include <cpgen/template_manager.h>
+
+#include <benchmark/benchmark.h>
+#include <fmt/format.h>
+
+#include <filesystem>
+#include <string>
+#include <unistd.h>
+
+namespace {
+
+namespace fs = std::filesystem;
+
+// Generates into a fresh directory at each iteration since existing files are
+// not overwritten. The memory sink measures the generation without the disk
+template <typename Generate>
+void run(benchmark::State& state, const Generate& generate) {
+    cpgen::GenerationOptions options;
+    options.jobs = static_cast<std::size_t>(state.range(0));
+    options.output = static_cast<cpgen::OutputSinkType>(state.range(1));
+    cpgen::TemplateManager manager{options};
+
+    const auto root =
+        fs::temp_directory_path() / fmt::format("cpgen_bench_out.{}", getpid());
+
+    // Load the templates and build their index outside of the measurements
+    generate(manager, root);
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        fs::remove_all(root);
+        fs::create_directories(root);
+        state.ResumeTiming();
+
+        generate(manager, root);
+    }
+
+    fs::remove_all(root);
+}
+
+// sink: 0 = filesystem, 1 = batched, 2 = memory
+void args(benchmark::internal::Benchmark* benchmark) {
+    benchmark->ArgNames({"jobs", "sink"})
+        ->ArgsProduct({{1, 4}, {0, 1, 2}})
+        ->UseRealTime();
+}
+
+void BM_CreateProject(benchmark::State& state) {
+    run(state, [](cpgen::TemplateManager& manager, const fs::path& root) {
+        cpgen::ProjectParameters project;
+        project.name = "project";
+        project.root_path = root.native();
+        project.conan_pkgs = {"fmt/7.1.2", "catch2/2.13.0"};
+        project.cmake_pkgs = {"Threads"};
+        manager.createProject(project);
+    });
+}
+
+void BM_CreateLibrary(benchmark::State& state, cpgen::LibraryType type) {
+    run(state, [type](cpgen::TemplateManager& manager, const fs::path& root) {
+        cpgen::LibraryParameters library;
+        library.name = "library";
+        library.type = type;
+        library.dependencies = {"CONAN_PKG::fmt"};
+        manager.createLibrary(library, root);
+    });
+}
+
+void BM_CreateExecutable(benchmark::State& state) {
+    run(state, [](cpgen::TemplateManager& manager, const fs::path& root) {
+        cpgen::ExecutableParameters executable;
+        executable.name = "executable";
+        executable.dependencies = {"library"};
+        manager.createExecutable(executable, root);
+    });
+}
+
+void BM_CreateTest(benchmark::State& state) {
+    run(state, [](cpgen::TemplateManager& manager, const fs::path& root) {
+        cpgen::ExecutableParameters test;
+        test.name = "test";
+        test.dependencies = {"library"};
+        manager.createTest(test, root);
+    });
+}
+
+} // namespace
+
+BENCHMARK(BM_CreateProject)->Apply(args);
+BENCHMARK_CAPTURE(BM_CreateLibrary, static, cpgen::LibraryType::Static)
+    ->Apply(args);
+BENCHMARK_CAPTURE(BM_CreateLibrary, shared, cpgen::LibraryType::Shared)
+    ->Apply(args);
+BENCHMARK_CAPTURE(BM_CreateLibrary, header_only,
+                  cpgen::LibraryType::HeaderOnly)
+    ->Apply(args);
+BENCHMARK_CAPTURE(BM_CreateLibrary, module, cpgen::LibraryType::Module)
+    ->Apply(args);
+BENCHMARK_CAPTURE(BM_CreateLibrary, cxx_module, cpgen::LibraryType::CxxModule)
+    ->Apply(args);
+BENCHMARK(BM_CreateExecutable)->Apply(args);
+BENCHMARK(BM_CreateTest)->Apply(args);
@@ -13,11 +13,20 @@ else()
     set(conan_build_tests False)
 endif()
 
+if(ENABLE_BENCHMARKS)
+    set(conan_build_benchmarks True)
+else()
+    set(conan_build_benchmarks False)
+endif()
+
 conan_cmake_run(
     CONANFILE conanfile.py
     BASIC_SETUP CMAKE_TARGETS
     BUILD missing
-    OPTIONS ${PROJECT_NAME}:build_tests=${conan_build_tests}
+    OPTIONS
+        ${PROJECT_NAME}:build_tests=${conan_build_tests}
+        ${PROJECT_NAME}:build_benchmarks=${conan_build_benchmarks}
 )
 
-set(conan_build_tests)
\ No newline at end of file
+set(conan_build_tests)
+set(conan_build_benchmarks)
\ No newline at end of file
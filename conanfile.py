@@ -10,10 +10,10 @@ class CPGenConan(ConanFile):
     description = "A C++ project generator based on CMake and Conan"
     topics = "C++", "Conan", "CMake"
     settings = "os", "compiler", "build_type", "arch"
-    options = {"build_tests": [True, False]}
-    default_options = {"build_tests": False}
+    options = {"build_tests": [True, False], "build_benchmarks": [True, False]}
+    default_options = {"build_tests": False, "build_benchmarks": False}
     generators = "cmake"
-    requires = "fmt/7.1.2", "cli11/1.9.1", "libcurl/7.73.0", "libarchive/3.4.3"
+    requires = "fmt/7.1.2", "cli11/1.9.1", "libcurl/7.73.0", "libarchive/3.4.3", "nlohmann_json/3.9.1"
     exports_sources = "!.clangd*", "!.ccls-cache*", "!compile_commands.json", "*"
 
     def configure(self):
@@ -23,11 +23,15 @@ class CPGenConan(ConanFile):
         if self.options.build_tests:
             self.requires("cppcheck_installer/2.0@bincrafters/stable")
             self.requires("catch2/2.13.0")
+        if self.options.build_benchmarks:
+            self.requires("benchmark/1.5.2")
 
     def build(self):
         cmake = CMake(self)
         if self.options.build_tests:
             cmake.definitions["ENABLE_TESTING"] = True
+        if self.options.build_benchmarks:
+            cmake.definitions["ENABLE_BENCHMARKS"] = True
         cmake.configure()
         cmake.build()
         if self.options.build_tests:
@@ -4,6 +4,7 @@
 
 #include <memory>
 #include <optional>
+#include <string>
 #include <string_view>
 #include <vector>
 
@@ -13,6 +14,11 @@ class CliInterface {
 public:
     struct Options {
         bool update{false};
+        bool upgrade{false};
+        bool timings{false};
+        // Where to write the Chrome trace, tracing is disabled if empty
+        std::string trace_file{};
+        GenerationOptions generation{};
     };
 
     CliInterface(int argc, char* argv[]);
@@ -21,6 +27,7 @@ public:
     const std::vector<LibraryParameters>& libraries() const;
     const std::vector<ExecutableParameters>& executables() const;
     const std::vector<ExecutableParameters>& tests() const;
+    const std::vector<ExecutableParameters>& benchmarks() const;
     const std::optional<ProjectParameters>& project() const;
     const Options& options() const;
 
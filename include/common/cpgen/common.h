@@ -1,22 +1,69 @@
 #pragma once
 
+#include <cstddef>
+#include <optional>
 #include <string>
 #include <vector>
 
 namespace cpgen {
 
-enum class LibraryType { Static, Shared, HeaderOnly, Module };
+enum class SubstitutionEngine { Scanner, Regex };
+// Filesystem: files are written as soon as they are rendered
+// Batched: files are collected in memory and written at the end
+// Memory: nothing is written
+enum class OutputSinkType { Filesystem, Batched, Memory };
+struct GenerationOptions {
+    SubstitutionEngine engine{SubstitutionEngine::Scanner};
+    OutputSinkType output{OutputSinkType::Filesystem};
+    // Render in memory and print what would have been generated
+    bool dry_run{false};
+    // Number of threads used to generate the files, 0 means all available
+    std::size_t jobs{1};
+    // Render the templates from the downloaded archive instead of extracting it
+    bool from_archive{false};
+    // Extract the templates while they are being downloaded instead of
+    // saving the archive first
+    bool stream_update{false};
+    // Where to download the templates from, the official ones if empty
+    std::string templates_url{};
+};
+
+// Module is a CMake MODULE library (a plugin loaded at runtime), CxxModule a
+// library exporting a C++20 named module
+enum class LibraryType { Static, Shared, HeaderOnly, Module, CxxModule };
 struct LibraryParameters {
     std::string name{};
     LibraryType type{LibraryType::Static};
     std::vector<std::string> dependencies;
     std::string standard{"11"};
+    // Compile the sources in batches (CMake UNITY_BUILD)
+    bool unity{false};
+    // Enable link time optimization (CMake INTERPROCEDURAL_OPTIMIZATION)
+    bool lto{false};
+    // Headers to precompile, the project ones are reused if empty
+    std::vector<std::string> precompiled_headers;
 };
 
 struct ExecutableParameters {
     std::string name{};
     std::vector<std::string> dependencies;
     std::string standard{"11"};
+    // Compile the sources in batches (CMake UNITY_BUILD)
+    bool unity{false};
+    // Enable link time optimization (CMake INTERPROCEDURAL_OPTIMIZATION)
+    bool lto{false};
+    // Headers to precompile, the project ones are reused if empty
+    std::vector<std::string> precompiled_headers;
+    // Run by the pgo-train target of the project to gather the profiles
+    // (executables only)
+    bool pgo_training{false};
+    // Framework the test cases are written with (catch2, gtest or none), to
+    // register them one by one to CTest (tests only)
+    std::string test_framework{"none"};
+    // CTest labels of the test cases (tests only)
+    std::vector<std::string> test_labels;
+    // CTest RESOURCE_GROUPS property of the test cases (tests only)
+    std::string test_resource_groups{};
 };
 
 struct ProjectParameters {
@@ -26,6 +73,17 @@ struct ProjectParameters {
     std::vector<std::string> conan_pkgs;
     std::vector<std::string> cmake_pkgs;
     std::string root_path{"."};
+    // Headers precompiled once and shared by the components
+    std::vector<std::string> precompiled_headers;
+};
+
+// A project and/or components to generate at once
+struct BatchParameters {
+    std::optional<ProjectParameters> project;
+    std::vector<LibraryParameters> libraries;
+    std::vector<ExecutableParameters> executables;
+    std::vector<ExecutableParameters> tests;
+    std::vector<ExecutableParameters> benchmarks;
 };
 
 } // namespace cpgen
\ No newline at end of file
@@ -2,14 +2,26 @@
 
 #include <cpgen/common.h>
 
+#include <chrono>
+#include <cstddef>
 #include <filesystem>
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace cpgen {
 
+struct ComponentTiming {
+    std::string name;
+    // Number of files written
+    std::size_t files{};
+    // Time spent rendering the files, summed over all the threads
+    std::chrono::nanoseconds render_time{};
+};
+
 class TemplateManager {
 public:
-    TemplateManager();
+    explicit TemplateManager(GenerationOptions options = {});
     ~TemplateManager(); // = default
 
     void update();
@@ -25,6 +37,21 @@ public:
     void createTest(const ExecutableParameters& test,
                     std::filesystem::path project_root);
 
+    void createBenchmark(const ExecutableParameters& benchmark,
+                         std::filesystem::path project_root);
+
+    // Renders all the components in parallel. The result is the same as
+    // creating them one after the other, project first
+    std::vector<ComponentTiming>
+    createBatch(const BatchParameters& batch,
+                std::filesystem::path project_root);
+
+    // Re-renders the files of the project whose template changed since they
+    // were generated, unless they were modified in the meantime, and adds the
+    // new template files. Returns false if the project marker cannot be read
+    // or saved
+    bool upgrade(const std::filesystem::path& project_root);
+
 private:
     class pImpl;
     std::unique_ptr<pImpl> impl_;
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace cpgen {
+
+// Records timed spans and writes them to a file in the Chrome trace event
+// format, which can be opened with Perfetto or chrome://tracing. Spans are
+// only recorded while a Tracer exists
+class Tracer {
+public:
+    using clock = std::chrono::steady_clock;
+    using Args = std::vector<std::pair<std::string, std::int64_t>>;
+
+    // Becomes the active tracer
+    explicit Tracer(std::filesystem::path file);
+    // Writes the trace file
+    ~Tracer();
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    // nullptr if tracing is disabled
+    static Tracer* active();
+
+    // Thread safe
+    void addSpan(std::string_view category, std::string_view name,
+                 clock::time_point start, clock::time_point end,
+                 Args args = {});
+
+private:
+    class pImpl;
+    std::unique_ptr<pImpl> impl_;
+};
+
+// Records a span from its construction to its destruction. Does nothing
+// beyond checking for an active Tracer if tracing is disabled
+class TraceSpan {
+public:
+    TraceSpan(std::string_view category, std::string_view name)
+        : tracer_{Tracer::active()} {
+        if (tracer_) {
+            category_ = category;
+            name_ = name;
+            start_ = Tracer::clock::now();
+        }
+    }
+
+    ~TraceSpan() {
+        if (tracer_) {
+            tracer_->addSpan(category_, name_, start_, Tracer::clock::now(),
+                             std::move(args_));
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    // Can be used to skip the computation of expensive arguments
+    bool enabled() const {
+        return tracer_ != nullptr;
+    }
+
+    void arg(std::string_view key, std::int64_t value) {
+        if (tracer_) {
+            args_.emplace_back(key, value);
+        }
+    }
+
+private:
+    Tracer* tracer_;
+    std::string category_;
+    std::string name_;
+    Tracer::clock::time_point start_;
+    Tracer::Args args_;
+};
+
+} // namespace cpgen
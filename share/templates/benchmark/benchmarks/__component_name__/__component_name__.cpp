@@ -0,0 +1,12 @@
+#include <benchmark/benchmark.h>
+
+// Replace with the code to measure, see
+// https://github.com/google/benchmark/blob/master/docs/user_guide.md
+static void example(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(example);
+
+BENCHMARK_MAIN();
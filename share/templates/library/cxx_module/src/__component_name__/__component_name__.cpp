@@ -0,0 +1 @@
+module __component_module_name__;
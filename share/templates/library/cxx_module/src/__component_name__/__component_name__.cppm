@@ -0,0 +1,4 @@
+export module __component_module_name__;
+
+export namespace __component_namespace__ {
+}
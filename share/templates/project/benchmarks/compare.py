@@ -0,0 +1,59 @@
+#!/usr/bin/env python3
+"""Compares Google Benchmark JSON results with a baseline.
+
+usage: compare.py <results dir> <baseline dir> [threshold]
+
+Prints the change of the real time of each benchmark found in both and fails
+if one of them got slower by more than threshold percent, when given.
+"""
+
+import json
+import pathlib
+import sys
+
+TO_NS = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+
+def load(file):
+    with open(file) as f:
+        benchmarks = json.load(f)["benchmarks"]
+    # Skip the aggregates (mean, median...) of repeated benchmarks
+    return {b["name"]: b["real_time"] * TO_NS[b["time_unit"]]
+            for b in benchmarks if b.get("run_type", "iteration") == "iteration"}
+
+
+def main():
+    if len(sys.argv) < 3:
+        print(__doc__)
+        return 2
+
+    results_dir = pathlib.Path(sys.argv[1])
+    baseline_dir = pathlib.Path(sys.argv[2])
+    threshold = float(sys.argv[3]) if len(sys.argv) > 3 else None
+
+    regressions = []
+    for results_file in sorted(results_dir.glob("*.json")):
+        baseline_file = baseline_dir / results_file.name
+        if not baseline_file.exists():
+            print(f"{results_file.stem}: no baseline")
+            continue
+
+        baseline = load(baseline_file)
+        for name, time in load(results_file).items():
+            if name not in baseline:
+                continue
+            change = (time - baseline[name]) / baseline[name] * 100
+            print(f"{name:<50} {baseline[name]:>14.3f}ns {time:>14.3f}ns "
+                  f"{change:>+8.2f}%")
+            if threshold is not None and change > threshold:
+                regressions.append(name)
+
+    if regressions:
+        print(f"{len(regressions)} benchmark(s) slower by more than "
+              f"{threshold}%: {', '.join(regressions)}")
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
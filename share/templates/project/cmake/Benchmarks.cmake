@@ -0,0 +1,57 @@
+# The benchmarks are built with ENABLE_BENCHMARKS and run by the
+# run-benchmarks target, which writes their results in JSON. If a baseline is
+# given, the results are compared with it
+set(BENCHMARK_RESULTS_DIR ${CMAKE_BINARY_DIR}/benchmark-results CACHE PATH "Where the benchmark results are written")
+set(BENCHMARK_BASELINE_DIR "" CACHE PATH "Results to compare the benchmarks with, none if empty")
+set(BENCHMARK_REGRESSION_THRESHOLD "" CACHE STRING "Slowdown, in percent, over which the comparison with the baseline fails, none if empty")
+
+# Registers the target to be run by run-benchmarks
+function(add_benchmark target)
+    set_property(GLOBAL APPEND PROPERTY BENCHMARK_TARGETS ${target})
+endfunction(add_benchmark)
+
+# Adds the run-benchmarks target, and save-benchmarks-baseline if a baseline
+# is set, to be called once all the benchmarks are defined
+function(add_run_benchmarks_target)
+    get_property(targets GLOBAL PROPERTY BENCHMARK_TARGETS)
+    if(NOT targets)
+        return()
+    endif()
+
+    set(commands COMMAND ${CMAKE_COMMAND} -E make_directory ${BENCHMARK_RESULTS_DIR})
+    foreach(target IN LISTS targets)
+        list(APPEND commands
+            COMMAND $<TARGET_FILE:${target}>
+                --benchmark_out=${BENCHMARK_RESULTS_DIR}/${target}.json
+                --benchmark_out_format=json
+        )
+    endforeach()
+
+    if(BENCHMARK_BASELINE_DIR)
+        find_package(Python3 COMPONENTS Interpreter)
+        if(Python3_FOUND)
+            list(APPEND commands
+                COMMAND ${Python3_EXECUTABLE} ${CMAKE_SOURCE_DIR}/benchmarks/compare.py
+                    ${BENCHMARK_RESULTS_DIR} ${BENCHMARK_BASELINE_DIR} ${BENCHMARK_REGRESSION_THRESHOLD}
+            )
+        else()
+            message(WARNING "Python 3 is needed to compare the benchmark results with the baseline but it was not found")
+        endif()
+
+        add_custom_target(
+            save-benchmarks-baseline
+            COMMAND ${CMAKE_COMMAND} -E copy_directory ${BENCHMARK_RESULTS_DIR} ${BENCHMARK_BASELINE_DIR}
+            COMMENT "Saving the benchmark results as the new baseline"
+            VERBATIM
+        )
+    endif()
+
+    add_custom_target(
+        run-benchmarks
+        ${commands}
+        DEPENDS ${targets}
+        WORKING_DIRECTORY ${CMAKE_BINARY_DIR}
+        COMMENT "Running the benchmarks"
+        VERBATIM
+    )
+endfunction(add_run_benchmarks_target)
\ No newline at end of file
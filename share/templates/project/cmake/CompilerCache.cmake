@@ -0,0 +1,62 @@
+# Caches the compilation results with ccache or sccache. The paths of the
+# project are kept out of the cache keys so that rebuilds from another
+# checkout are cache hits too
+include(CheckCXXCompilerFlag)
+
+option(ENABLE_COMPILER_CACHE "Use ccache or sccache when available" ON)
+set(COMPILER_CACHE "auto" CACHE STRING "Compiler cache to use (auto, ccache or sccache)")
+set_property(CACHE COMPILER_CACHE PROPERTY STRINGS auto ccache sccache)
+
+set(compiler_cache_summary "disabled")
+if(ENABLE_COMPILER_CACHE)
+    if(COMPILER_CACHE STREQUAL "auto")
+        set(compiler_cache_names ccache sccache)
+    else()
+        set(compiler_cache_names ${COMPILER_CACHE})
+    endif()
+    # Looked up again each time in case COMPILER_CACHE changed
+    unset(COMPILER_CACHE_PROGRAM CACHE)
+    find_program(COMPILER_CACHE_PROGRAM NAMES ${compiler_cache_names})
+
+    if(COMPILER_CACHE_PROGRAM)
+        get_filename_component(compiler_cache_name ${COMPILER_CACHE_PROGRAM} NAME_WE)
+        if(compiler_cache_name STREQUAL "ccache")
+            # base_dir makes the paths relative, hash_dir=false ignores the
+            # working directory and the sloppiness allows precompiled headers
+            set(compiler_cache_launcher
+                ${CMAKE_COMMAND} -E env
+                CCACHE_BASEDIR=${CMAKE_SOURCE_DIR}
+                CCACHE_NOHASHDIR=true
+                CCACHE_SLOPPINESS=pch_defines,time_macros,include_file_mtime,include_file_ctime
+                ${COMPILER_CACHE_PROGRAM}
+            )
+            if(CMAKE_CXX_COMPILER_ID STREQUAL "GNU")
+                add_compile_options(-fpch-preprocess)
+            endif()
+        else()
+            set(compiler_cache_launcher ${COMPILER_CACHE_PROGRAM})
+        endif()
+
+        get_property(languages GLOBAL PROPERTY ENABLED_LANGUAGES)
+        foreach(lang IN LISTS languages)
+            set(CMAKE_${lang}_COMPILER_LAUNCHER ${compiler_cache_launcher})
+        endforeach()
+
+        # Deterministic __FILE__ and debug information whatever the checkout path
+        check_cxx_compiler_flag(-ffile-prefix-map=${CMAKE_SOURCE_DIR}=. HAS_FILE_PREFIX_MAP)
+        if(HAS_FILE_PREFIX_MAP)
+            add_compile_options(-ffile-prefix-map=${CMAKE_SOURCE_DIR}=.)
+        endif()
+
+        set(compiler_cache_summary "${compiler_cache_name} (${COMPILER_CACHE_PROGRAM})")
+    else()
+        set(compiler_cache_summary "not found")
+    endif()
+endif()
+
+message(STATUS "Compiler cache: ${compiler_cache_summary}")
+
+set(compiler_cache_summary)
+set(compiler_cache_names)
+set(compiler_cache_name)
+set(compiler_cache_launcher)
\ No newline at end of file
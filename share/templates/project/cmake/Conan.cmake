@@ -13,11 +13,28 @@ else()
     set(conan_build_tests False)
 endif()
 
+if(ENABLE_BENCHMARKS)
+    set(conan_build_benchmarks True)
+else()
+    set(conan_build_benchmarks False)
+endif()
+
+# Conan only knows the standard build types, Profile builds use the Release
+# packages
+if(CMAKE_BUILD_TYPE STREQUAL "Profile")
+    set(conan_build_type BUILD_TYPE Release)
+endif()
+
 conan_cmake_run(
     CONANFILE conanfile.py
     BASIC_SETUP CMAKE_TARGETS
     BUILD missing
-    OPTIONS ${PROJECT_NAME}:build_tests=${conan_build_tests}
+    ${conan_build_type}
+    OPTIONS
+        ${PROJECT_NAME}:build_tests=${conan_build_tests}
+        ${PROJECT_NAME}:build_benchmarks=${conan_build_benchmarks}
 )
 
-set(conan_build_tests)
\ No newline at end of file
+set(conan_build_tests)
+set(conan_build_benchmarks)
+set(conan_build_type)
\ No newline at end of file
@@ -3,6 +3,12 @@
 add_library(coverage_config INTERFACE)
 
 option(ENABLE_LCOV "Enable coverage reporting using lcov" OFF)
+
+# The coverage flags would distort the profiles
+if(ENABLE_LCOV AND CMAKE_BUILD_TYPE STREQUAL "Profile")
+  message(WARNING "Coverage reporting is disabled in Profile builds")
+  set(ENABLE_LCOV OFF)
+endif()
 if(ENABLE_LCOV AND CMAKE_CXX_COMPILER_ID MATCHES "GNU|Clang")
   find_program(LCOV lcov)
   if(LCOV)
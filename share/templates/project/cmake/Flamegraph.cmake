@@ -0,0 +1,35 @@
+# Turns a perf recording into folded stacks and a flamegraph, used by the
+# perf-<target> targets:
+#   cmake -DPERF=<perf> -DDATA=<perf.data> -DOUTPUT=<prefix>
+#         [-DSTACKCOLLAPSE_PERF=<stackcollapse-perf.pl>]
+#         [-DFLAMEGRAPH=<flamegraph.pl>] -P Flamegraph.cmake
+if(NOT STACKCOLLAPSE_PERF)
+    message(STATUS "Recording saved to ${DATA}. Install the FlameGraph tools "
+                   "(https://github.com/brendangregg/FlameGraph) or inferno to get a flamegraph")
+    return()
+endif()
+
+execute_process(
+    COMMAND ${PERF} script -i ${DATA}
+    COMMAND ${STACKCOLLAPSE_PERF}
+    OUTPUT_FILE ${OUTPUT}.folded
+    RESULT_VARIABLE result
+)
+if(result)
+    message(FATAL_ERROR "Failed to fold the stacks of ${DATA}: ${result}")
+endif()
+
+if(NOT FLAMEGRAPH)
+    message(STATUS "Folded stacks written to ${OUTPUT}.folded")
+    return()
+endif()
+
+execute_process(
+    COMMAND ${FLAMEGRAPH} ${OUTPUT}.folded
+    OUTPUT_FILE ${OUTPUT}.svg
+    RESULT_VARIABLE result
+)
+if(result)
+    message(FATAL_ERROR "Failed to generate the flamegraph of ${DATA}: ${result}")
+endif()
+message(STATUS "Flamegraph written to ${OUTPUT}.svg")
\ No newline at end of file
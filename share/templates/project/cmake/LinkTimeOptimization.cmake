@@ -0,0 +1,27 @@
+# Link time optimization allows inlining across translation units. CMake uses
+# ThinLTO with Clang, which links much faster than a full LTO
+include(CheckIPOSupported)
+
+option(ENABLE_LTO "Enable link time optimization for all the targets" OFF)
+
+# Enables link time optimization for the target if either ENABLE_LTO or enabled
+# is ON. A warning is printed and the target is built without it if the
+# toolchain doesn't support it
+function(enable_lto target enabled)
+    if(NOT (ENABLE_LTO OR enabled))
+        return()
+    endif()
+
+    # The check builds a test project so it is only done once
+    if(NOT DEFINED LTO_SUPPORTED)
+        check_ipo_supported(RESULT supported OUTPUT output LANGUAGES CXX)
+        set(LTO_SUPPORTED ${supported} CACHE INTERNAL "Link time optimization support")
+        if(NOT supported)
+            message(WARNING "Link time optimization is not supported: ${output}")
+        endif()
+    endif()
+
+    if(LTO_SUPPORTED)
+        set_target_properties(${target} PROPERTIES INTERPROCEDURAL_OPTIMIZATION ON)
+    endif()
+endfunction(enable_lto)
\ No newline at end of file
@@ -0,0 +1,58 @@
+# Links with mold or lld, which are much faster than the default linkers, and
+# splits the debug information out of the objects to reduce the link work
+include(CheckCXXCompilerFlag)
+include(CheckCXXSourceCompiles)
+
+option(ENABLE_FAST_LINKER "Link with mold or lld when available" ON)
+set(FAST_LINKER "auto" CACHE STRING "Linker to use (auto, mold or lld)")
+set_property(CACHE FAST_LINKER PROPERTY STRINGS auto mold lld)
+option(ENABLE_SPLIT_DWARF "Split the debug information in Debug, RelWithDebInfo and Profile builds" ON)
+
+set(linker_summary "default")
+if(ENABLE_FAST_LINKER AND NOT MSVC)
+    if(FAST_LINKER STREQUAL "auto")
+        set(linker_candidates mold lld)
+    else()
+        set(linker_candidates ${FAST_LINKER})
+    endif()
+
+    foreach(linker IN LISTS linker_candidates)
+        # The result is cached for each linker
+        set(CMAKE_REQUIRED_LINK_OPTIONS -fuse-ld=${linker})
+        check_cxx_source_compiles("int main() { return 0; }" HAS_LINKER_${linker})
+        set(CMAKE_REQUIRED_LINK_OPTIONS)
+        if(HAS_LINKER_${linker})
+            if(CMAKE_VERSION VERSION_GREATER_EQUAL 3.29)
+                string(TOUPPER ${linker} CMAKE_LINKER_TYPE)
+            else()
+                add_link_options(-fuse-ld=${linker})
+            endif()
+            set(linker_summary ${linker})
+            break()
+        endif()
+    endforeach()
+
+    set(linker_candidates)
+endif()
+
+set(split_dwarf_summary "off")
+if(ENABLE_SPLIT_DWARF)
+    check_cxx_compiler_flag(-gsplit-dwarf HAS_SPLIT_DWARF)
+    if(HAS_SPLIT_DWARF)
+        set(debug_configs $<OR:$<CONFIG:Debug>,$<CONFIG:RelWithDebInfo>,$<CONFIG:Profile>>)
+        add_compile_options($<${debug_configs}:-gsplit-dwarf>)
+        # The GNU BFD linker can't build the index
+        if(NOT linker_summary STREQUAL "default")
+            add_link_options($<${debug_configs}:-Wl,--gdb-index>)
+        endif()
+        set(split_dwarf_summary "on")
+        set(debug_configs)
+    else()
+        set(split_dwarf_summary "not supported")
+    endif()
+endif()
+
+message(STATUS "Linker: ${linker_summary}, split debug information: ${split_dwarf_summary}")
+
+set(linker_summary)
+set(split_dwarf_summary)
\ No newline at end of file
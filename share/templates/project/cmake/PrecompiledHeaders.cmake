@@ -0,0 +1,68 @@
+# Precompiled headers are parsed once per target instead of once per source
+option(ENABLE_PCH "Enable precompiled headers" ON)
+
+# Headers precompiled once for the whole project (e.g "<fmt/format.h>"), in
+# the project_pch target. The components without headers of their own reuse it
+set(PROJECT_PCH_HEADERS __project_pch__)
+set(PROJECT_PCH_STD 11 CACHE STRING "C++ standard the project precompiled header is built with")
+
+if(ENABLE_PCH AND PROJECT_PCH_HEADERS)
+    set(project_pch_source ${CMAKE_CURRENT_BINARY_DIR}/project_pch.cpp)
+    if(NOT EXISTS ${project_pch_source})
+        file(WRITE ${project_pch_source} "")
+    endif()
+
+    add_library(project_pch STATIC ${project_pch_source})
+    target_precompile_headers(project_pch PRIVATE ${PROJECT_PCH_HEADERS})
+    target_compile_features(project_pch PRIVATE cxx_std_${PROJECT_PCH_STD})
+    target_link_libraries(project_pch PRIVATE coverage_config ${CONAN_TARGETS})
+    add_warnings(project_pch)
+
+    set(project_pch_source)
+endif()
+
+# A precompiled header can only be used with the position independent code
+# settings it was built with (none, -fPIC or -fPIE)
+function(get_position_independent_mode target result)
+    get_target_property(type ${target} TYPE)
+    get_target_property(pic ${target} POSITION_INDEPENDENT_CODE)
+    if(pic STREQUAL "pic-NOTFOUND")
+        if(type MATCHES "^(SHARED|MODULE)_LIBRARY$")
+            set(pic ON)
+        else()
+            set(pic OFF)
+        endif()
+    endif()
+
+    if(NOT pic)
+        set(${result} none PARENT_SCOPE)
+    elseif(type STREQUAL "EXECUTABLE")
+        set(${result} pie PARENT_SCOPE)
+    else()
+        set(${result} pic PARENT_SCOPE)
+    endif()
+endfunction(get_position_independent_mode)
+
+# Precompiles the given headers for the target. Without headers, the project
+# precompiled header is reused if it was built with the same standard and
+# position independent code settings, or built again for the target otherwise
+function(use_precompiled_headers target std)
+    if(NOT ENABLE_PCH)
+        return()
+    endif()
+
+    if(ARGN)
+        target_precompile_headers(${target} PRIVATE ${ARGN})
+        return()
+    elseif(NOT TARGET project_pch)
+        return()
+    endif()
+
+    get_position_independent_mode(${target} target_mode)
+    get_position_independent_mode(project_pch project_pch_mode)
+    if(std STREQUAL PROJECT_PCH_STD AND target_mode STREQUAL project_pch_mode)
+        target_precompile_headers(${target} REUSE_FROM project_pch)
+    else()
+        target_precompile_headers(${target} PRIVATE ${PROJECT_PCH_HEADERS})
+    endif()
+endfunction(use_precompiled_headers)
\ No newline at end of file
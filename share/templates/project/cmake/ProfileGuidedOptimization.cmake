@@ -0,0 +1,95 @@
+# Two stages profile guided optimization with GCC or Clang:
+# 1. configure with -DPGO_MODE=generate, build and run the training
+#    executables with the pgo-train target
+# 2. configure again with -DPGO_MODE=use and build the optimized binaries
+set(PGO_MODE "off" CACHE STRING "Profile guided optimization stage (off, generate or use)")
+set_property(CACHE PGO_MODE PROPERTY STRINGS off generate use)
+set(PGO_PROFILE_DIR ${CMAKE_BINARY_DIR}/pgo-profiles CACHE PATH "Where the profiles are written and read")
+
+# Clang profiles have to be merged before being used
+set(pgo_profdata ${PGO_PROFILE_DIR}/default.profdata)
+
+if(NOT PGO_MODE STREQUAL "off")
+    if(CMAKE_CXX_COMPILER_ID STREQUAL "GNU")
+        if(PGO_MODE STREQUAL "generate")
+            add_compile_options(-fprofile-generate=${PGO_PROFILE_DIR})
+            add_link_options(-fprofile-generate=${PGO_PROFILE_DIR})
+        elseif(PGO_MODE STREQUAL "use")
+            if(NOT EXISTS ${PGO_PROFILE_DIR})
+                message(WARNING "No profile in ${PGO_PROFILE_DIR}, build the pgo-train target with PGO_MODE=generate first")
+            endif()
+            # Profiles of multithreaded programs may be slightly inconsistent
+            add_compile_options(-fprofile-use=${PGO_PROFILE_DIR} -fprofile-correction -Wno-missing-profile)
+        endif()
+    elseif(CMAKE_CXX_COMPILER_ID MATCHES "Clang")
+        get_filename_component(compiler_dir ${CMAKE_CXX_COMPILER} DIRECTORY)
+        string(REGEX MATCH "^[0-9]+" compiler_major ${CMAKE_CXX_COMPILER_VERSION})
+        find_program(LLVM_PROFDATA NAMES llvm-profdata llvm-profdata-${compiler_major} HINTS ${compiler_dir})
+        if(NOT LLVM_PROFDATA)
+            message(FATAL_ERROR "llvm-profdata is needed to merge the Clang profiles but it was not found")
+        endif()
+
+        if(PGO_MODE STREQUAL "generate")
+            add_compile_options(-fprofile-generate=${PGO_PROFILE_DIR})
+            add_link_options(-fprofile-generate=${PGO_PROFILE_DIR})
+        elseif(PGO_MODE STREQUAL "use")
+            if(NOT EXISTS ${pgo_profdata})
+                message(FATAL_ERROR "No profile in ${PGO_PROFILE_DIR}, build the pgo-train target with PGO_MODE=generate first")
+            endif()
+            add_compile_options(-fprofile-use=${pgo_profdata} -Wno-profile-instr-unprofiled -Wno-profile-instr-out-of-date)
+        endif()
+
+        set(compiler_dir)
+        set(compiler_major)
+    else()
+        message(WARNING "Profile guided optimization is only supported with GCC and Clang")
+    endif()
+
+    message(STATUS "Profile guided optimization: ${PGO_MODE} (${PGO_PROFILE_DIR})")
+endif()
+
+# Runs the target, with the given arguments, to gather the profiles when
+# enabled is ON
+function(pgo_training target enabled)
+    if(enabled)
+        set_property(GLOBAL APPEND PROPERTY PGO_TRAINING_TARGETS ${target})
+        set_target_properties(${target} PROPERTIES PGO_TRAINING_ARGS "${ARGN}")
+    endif()
+endfunction(pgo_training)
+
+# Adds the pgo-train target running all the training executables, to be called
+# once all the targets are defined
+function(add_pgo_train_target)
+    if(NOT PGO_MODE STREQUAL "generate")
+        return()
+    endif()
+
+    get_property(targets GLOBAL PROPERTY PGO_TRAINING_TARGETS)
+    if(NOT targets)
+        message(WARNING "No training executable, create them with the --pgo-training option of cpgen or call pgo_training()")
+        return()
+    endif()
+
+    # The profiles of a previous training are removed, as they would otherwise
+    # be cumulated with the new ones
+    set(commands
+        COMMAND ${CMAKE_COMMAND} -E remove_directory ${PGO_PROFILE_DIR}
+        COMMAND ${CMAKE_COMMAND} -E make_directory ${PGO_PROFILE_DIR}
+    )
+    foreach(target IN LISTS targets)
+        get_target_property(args ${target} PGO_TRAINING_ARGS)
+        list(APPEND commands COMMAND $<TARGET_FILE:${target}> ${args})
+    endforeach()
+    if(CMAKE_CXX_COMPILER_ID MATCHES "Clang")
+        list(APPEND commands COMMAND ${LLVM_PROFDATA} merge -output=${pgo_profdata} ${PGO_PROFILE_DIR})
+    endif()
+
+    add_custom_target(
+        pgo-train
+        ${commands}
+        DEPENDS ${targets}
+        WORKING_DIRECTORY ${CMAKE_BINARY_DIR}
+        COMMENT "Gathering the profiles of the training executables"
+        VERBATIM
+    )
+endfunction(add_pgo_train_target)
\ No newline at end of file
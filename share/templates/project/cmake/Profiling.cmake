@@ -0,0 +1,53 @@
+# Profile build type: optimized like Release, but with the debug information
+# and the frame pointers needed by profilers to get complete call stacks
+# project() already creates empty flags when Profile is given on the command line
+if(NOT CMAKE_CXX_FLAGS_PROFILE)
+    set(CMAKE_CXX_FLAGS_PROFILE "-O2 -g -fno-omit-frame-pointer -DNDEBUG" CACHE STRING "Flags used by the C++ compiler during Profile builds" FORCE)
+endif()
+set(CMAKE_EXE_LINKER_FLAGS_PROFILE "" CACHE STRING "Flags used by the linker during Profile builds")
+set(CMAKE_SHARED_LINKER_FLAGS_PROFILE "" CACHE STRING "Flags used by the linker during Profile builds")
+set(CMAKE_MODULE_LINKER_FLAGS_PROFILE "" CACHE STRING "Flags used by the linker during Profile builds")
+mark_as_advanced(
+    CMAKE_CXX_FLAGS_PROFILE
+    CMAKE_EXE_LINKER_FLAGS_PROFILE
+    CMAKE_SHARED_LINKER_FLAGS_PROFILE
+    CMAKE_MODULE_LINKER_FLAGS_PROFILE
+)
+
+if(CMAKE_CONFIGURATION_TYPES AND NOT "Profile" IN_LIST CMAKE_CONFIGURATION_TYPES)
+    list(APPEND CMAKE_CONFIGURATION_TYPES Profile)
+    set(CMAKE_CONFIGURATION_TYPES ${CMAKE_CONFIGURATION_TYPES} CACHE STRING "" FORCE)
+endif()
+
+# perf-<target> targets record the execution of a target with perf and turn
+# the recording into folded stacks and a flamegraph, in build/profiling
+find_program(PERF perf)
+find_program(STACKCOLLAPSE_PERF NAMES stackcollapse-perf.pl inferno-collapse-perf)
+find_program(FLAMEGRAPH NAMES flamegraph.pl inferno-flamegraph)
+set(PROFILING_DIR ${CMAKE_BINARY_DIR}/profiling)
+set(FLAMEGRAPH_SCRIPT ${CMAKE_CURRENT_LIST_DIR}/Flamegraph.cmake)
+
+# Adds a perf-<target> target running the target with the given arguments
+function(add_perf_target target)
+    if(NOT PERF)
+        return()
+    endif()
+
+    set(data ${PROFILING_DIR}/${target}.data)
+    add_custom_target(
+        perf-${target}
+        COMMAND ${CMAKE_COMMAND} -E make_directory ${PROFILING_DIR}
+        COMMAND ${PERF} record --call-graph=fp -o ${data} -- $<TARGET_FILE:${target}> ${ARGN}
+        COMMAND ${CMAKE_COMMAND}
+            -DPERF=${PERF}
+            -DSTACKCOLLAPSE_PERF=${STACKCOLLAPSE_PERF}
+            -DFLAMEGRAPH=${FLAMEGRAPH}
+            -DDATA=${data}
+            -DOUTPUT=${PROFILING_DIR}/${target}
+            -P ${FLAMEGRAPH_SCRIPT}
+        DEPENDS ${target}
+        WORKING_DIRECTORY ${CMAKE_BINARY_DIR}
+        COMMENT "Profiling ${target} with perf"
+        VERBATIM
+    )
+endfunction(add_perf_target)
\ No newline at end of file
@@ -0,0 +1,52 @@
+# Registers the tests to CTest. With a test framework, the test cases are listed
+# once the test executable is built and registered one by one, so that ctest -j
+# runs them in parallel and -L or -I select them individually
+include(GoogleTest)
+
+# Catch.cmake is shipped with the catch2 package
+foreach(dir IN LISTS CONAN_LIB_DIRS_CATCH2)
+    list(APPEND CMAKE_MODULE_PATH ${dir}/cmake/Catch2)
+endforeach()
+
+# Registers the test cases of target, written with framework (catch2, gtest or
+# none), with the given labels. resource_groups is the RESOURCE_GROUPS property
+# of each test case (e.g 2,cpus:1), none if empty. The target is linked with the
+# Conan package of the framework
+function(register_tests target framework labels resource_groups)
+    # The discovered tests do not support list properties, the labels are set
+    # on the directory of the test instead
+    if(labels)
+        set_property(DIRECTORY APPEND PROPERTY LABELS ${labels})
+    endif()
+
+    set(properties)
+    if(resource_groups)
+        set(properties PROPERTIES RESOURCE_GROUPS ${resource_groups})
+    endif()
+
+    if(framework MATCHES "^(catch2|gtest)$")
+        if(TARGET CONAN_PKG::${framework})
+            target_link_libraries(${target} PRIVATE CONAN_PKG::${framework})
+        else()
+            message(WARNING "The ${framework} Conan package is missing, the ${target} test cases are not registered individually")
+            set(framework none)
+        endif()
+    endif()
+
+    if(framework STREQUAL "catch2")
+        include(Catch OPTIONAL RESULT_VARIABLE catch_module)
+        if(catch_module)
+            catch_discover_tests(${target} TEST_PREFIX "${target}:" ${properties})
+            return()
+        endif()
+        message(WARNING "Catch.cmake was not found, the ${target} test cases are not registered individually")
+    elseif(framework STREQUAL "gtest")
+        gtest_discover_tests(${target} TEST_PREFIX "${target}:" ${properties})
+        return()
+    endif()
+
+    add_test(NAME ${target} COMMAND ${target})
+    if(resource_groups)
+        set_tests_properties(${target} ${properties})
+    endif()
+endfunction(register_tests)
@@ -0,0 +1,15 @@
+# Unity builds merge the sources of a target into batches compiled as a
+# single translation unit, which saves most of the per file frontend work
+option(ENABLE_UNITY_BUILD "Enable unity builds for all the targets" OFF)
+set(UNITY_BUILD_BATCH_SIZE 8 CACHE STRING "Maximum number of sources merged in a unity batch")
+
+# Enables the unity build of a target if either ENABLE_UNITY_BUILD or enabled is ON
+function(enable_unity_build target enabled)
+    if(ENABLE_UNITY_BUILD OR enabled)
+        set_target_properties(
+            ${target} PROPERTIES
+            UNITY_BUILD ON
+            UNITY_BUILD_BATCH_SIZE ${UNITY_BUILD_BATCH_SIZE}
+        )
+    endif()
+endfunction(enable_unity_build)
\ No newline at end of file
@@ -1,5 +1,12 @@
+import glob
+import os
+import re
+
 from conans import ConanFile, CMake, tools
 
+# Packages of the test frameworks supported by register_tests()
+test_frameworks = {"catch2": "catch2/2.13.0", "gtest": "gtest/1.10.0"}
+
 
 class __project_name__Conan(ConanFile):
     name = "__project_name__"
@@ -10,16 +17,32 @@ class __project_name__Conan(ConanFile):
     topics = "C++", "Conan", "CMake"  # add/modify topics
     settings = "os", "compiler", "build_type", "arch"
     options = {"shared": [True, False], "fPIC": [
-        True, False], "build_tests": [True, False]}
-    default_options = {"shared": False, "fPIC": True, "build_tests": False}
+        True, False], "build_tests": [True, False],
+        "build_benchmarks": [True, False]}
+    default_options = {"shared": False, "fPIC": True, "build_tests": False,
+                       "build_benchmarks": False}
     generators = "cmake"
     requires = __conan_pkgs__
     exports_sources = "!.clangd*", "!.ccls-cache*", "!compile_commands.json", "*"
 
     def requirements(self):
         if self.options.build_tests:
-            # add test dependencies here if needed
-            pass
+            for framework in self._test_frameworks():
+                if framework not in self.requires:
+                    self.requires(test_frameworks[framework])
+            # add other test dependencies here if needed
+        if self.options.build_benchmarks:
+            self.requires("benchmark/1.5.2")
+
+    def _test_frameworks(self):
+        # Frameworks given to register_tests() by the tests of the project
+        frameworks = set()
+        tests = os.path.join(os.path.dirname(os.path.abspath(__file__)), "tests")
+        for cmake_file in glob.glob(os.path.join(tests, "*", "CMakeLists.txt")):
+            with open(cmake_file) as f:
+                frameworks.update(re.findall(
+                    r"register_tests\(\S+ (catch2|gtest)\b", f.read()))
+        return sorted(frameworks)
 
     def configure(self):
         if self.settings.compiler == 'Visual Studio':
@@ -29,6 +52,8 @@ class __project_name__Conan(ConanFile):
         cmake = CMake(self)
         if self.options.build_tests:
             cmake.definitions["ENABLE_TESTING"] = True
+        if self.options.build_benchmarks:
+            cmake.definitions["ENABLE_BENCHMARKS"] = True
         cmake.configure()
         cmake.build()
         if self.options.build_tests:
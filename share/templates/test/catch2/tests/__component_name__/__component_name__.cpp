@@ -0,0 +1,5 @@
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+TEST_CASE("__component_name__ works") {
+}
\ No newline at end of file
@@ -0,0 +1,4 @@
+#include <gtest/gtest.h>
+
+TEST(Test, Works) {
+}
\ No newline at end of file
@@ -27,6 +27,10 @@ const std::vector<ExecutableParameters>& CliInterface::tests() const {
     return impl().tests();
 }
 
+const std::vector<ExecutableParameters>& CliInterface::benchmarks() const {
+    return impl().benchmarks();
+}
+
 const std::optional<ProjectParameters>& CliInterface::project() const {
     return impl().project();
 }
@@ -1,9 +1,14 @@
 #include "cli_interface_impl.h"
+#include "manifest.h"
 
 #include <CLI/CLI.hpp>
 #include <fmt/format.h>
 
+#include <cctype>
+#include <iterator>
+#include <map>
 #include <stdexcept>
+#include <utility>
 #include <vector>
 
 namespace {
@@ -14,6 +19,27 @@ template <typename T> void set_if(CLI::Option* option, T& value) {
     }
 }
 
+// Dashes become underscores, dots separate the identifiers
+bool is_valid_module_name(const std::string& name) {
+    bool identifier_start = true;
+    for (const auto c : name) {
+        if (c == '.') {
+            if (identifier_start) {
+                return false;
+            }
+            identifier_start = true;
+        } else if (std::isalpha(static_cast<unsigned char>(c)) or c == '_' or
+                   c == '-' or
+                   (not identifier_start and
+                    std::isdigit(static_cast<unsigned char>(c)))) {
+            identifier_start = false;
+        } else {
+            return false;
+        }
+    }
+    return not identifier_start;
+}
+
 } // namespace
 
 namespace cpgen {
@@ -24,6 +50,7 @@ CliInterface::pImpl::pImpl(int argc, char* argv[])
     createAddLibraryCommand();
     createAddExecutableCommand();
     createAddTestCommand();
+    createAddBenchmarkCommand();
     createNewProjectCommand();
 
     app_.callback([&] {
@@ -37,6 +64,11 @@ CliInterface::pImpl::pImpl(int argc, char* argv[])
     } catch (const CLI::ParseError& e) {
         app_.exit(e);
     }
+
+    if (not manifest_.empty()) {
+        loadManifest();
+    }
+    checkLibraries();
 }
 
 const std::vector<LibraryParameters>& CliInterface::pImpl::libraries() const {
@@ -52,6 +84,11 @@ const std::vector<ExecutableParameters>& CliInterface::pImpl::tests() const {
     return tests_;
 }
 
+const std::vector<ExecutableParameters>&
+CliInterface::pImpl::benchmarks() const {
+    return benchmarks_;
+}
+
 const std::optional<ProjectParameters>& CliInterface::pImpl::project() const {
     return project_;
 }
@@ -64,6 +101,56 @@ void CliInterface::pImpl::addOptions() {
     auto update = app_.add_subcommand("update", "Update the templates");
     update->callback([&] { options_.update = true; });
     // app_.add_flag("--update", options_.update, "Update the templates");
+
+    auto upgrade = app_.add_subcommand(
+        "upgrade", "Upgrade the current project to the latest templates");
+    upgrade->callback([&] { options_.upgrade = true; });
+
+    const auto engines = std::map<std::string, SubstitutionEngine>{
+        {"scanner", SubstitutionEngine::Scanner},
+        {"regex", SubstitutionEngine::Regex}};
+    app_.add_option("--engine", options_.generation.engine,
+                    "The placeholder substitution engine (scanner or regex)")
+        ->transform(CLI::CheckedTransformer(engines, CLI::ignore_case));
+
+    app_.add_option("-j,--jobs", options_.generation.jobs,
+                    "The number of threads used to generate the files (0 to "
+                    "use all the available cores)");
+
+    app_.add_option("--templates-url", options_.generation.templates_url,
+                    "Download the templates from this URL (e.g "
+                    "file:///path/to/templates.tar.gz)");
+
+    app_.add_flag("--stream", options_.generation.stream_update,
+                  "Extract the templates while downloading them, without "
+                  "saving the archive");
+
+    app_.add_option("--manifest", manifest_,
+                    "A JSON file describing the project and/or the "
+                    "components to generate")
+        ->check(CLI::ExistingFile);
+
+    app_.add_flag("--timings", options_.timings,
+                  "Print the time spent in each step");
+
+    app_.add_option("--trace", options_.trace_file,
+                    "Write a trace of the execution to this file, in the "
+                    "Chrome trace format (open it with Perfetto or "
+                    "chrome://tracing)");
+
+    app_.add_flag("--dry-run", options_.generation.dry_run,
+                  "Print the files that would be generated without writing "
+                  "them");
+
+    app_.add_flag_callback(
+        "--batch-writes",
+        [this] { options_.generation.output = OutputSinkType::Batched; },
+        "Write all the generated files at once, at the end of the "
+        "generation");
+
+    app_.add_flag("--from-archive", options_.generation.from_archive,
+                  "Render the templates directly from the downloaded archive "
+                  "instead of extracting it");
 }
 
 void CliInterface::pImpl::createAddLibraryCommand() {
@@ -85,11 +172,27 @@ void CliInterface::pImpl::createAddLibraryCommand() {
             ->take_all()
             ->allow_extra_args(true);
 
+    auto pch = add_library
+                   ->add_option("--pch",
+                                "Headers to precompile for the library")
+                   ->take_all()
+                   ->allow_extra_args(true);
+
+    auto lto = add_library->add_flag(
+        "--lto", "Enable link time optimization for the library");
+
+    auto unity = add_library->add_flag(
+        "--unity", "Compile the library sources in batches (unity build)");
+
     add_library->needs(name);
     type->needs(name);
-    type->check(CLI::IsMember({"static", "shared", "header_only", "module"}));
+    type->check(CLI::IsMember(
+        {"static", "shared", "header_only", "module", "cxx_module"}));
     std->needs(name);
     deps->needs(name);
+    unity->needs(name);
+    lto->needs(name);
+    pch->needs(name);
 }
 
 void CliInterface::pImpl::onAddLibrary() {
@@ -108,6 +211,8 @@ void CliInterface::pImpl::onAddLibrary() {
             return LibraryType::HeaderOnly;
         } else if (type == "module") {
             return LibraryType::Module;
+        } else if (type == "cxx_module") {
+            return LibraryType::CxxModule;
         } else if (type.empty()) {
             return params.type;
         } else {
@@ -120,6 +225,12 @@ void CliInterface::pImpl::onAddLibrary() {
 
     set_if(add_library->get_option("--std"), params.standard);
 
+    params.unity = add_library->get_option("--unity")->count() > 0;
+    params.lto = add_library->get_option("--lto")->count() > 0;
+
+    params.precompiled_headers =
+        add_library->get_option("--pch")->as<std::vector<std::string>>();
+
     libraries_.emplace_back(params);
 }
 
@@ -141,9 +252,30 @@ void CliInterface::pImpl::createAddExecutableCommand() {
             ->take_all()
             ->allow_extra_args(true);
 
+    auto pch = add_exe
+                   ->add_option("--pch",
+                                "Headers to precompile for the executable")
+                   ->take_all()
+                   ->allow_extra_args(true);
+
+    auto lto = add_exe->add_flag(
+        "--lto", "Enable link time optimization for the executable");
+
+    auto pgo_training = add_exe->add_flag(
+        "--pgo-training",
+        "Run the executable to gather the profile guided optimization "
+        "profiles");
+
+    auto unity = add_exe->add_flag(
+        "--unity", "Compile the executable sources in batches (unity build)");
+
     add_exe->needs(name);
     std->needs(name);
     deps->needs(name);
+    unity->needs(name);
+    lto->needs(name);
+    pgo_training->needs(name);
+    pch->needs(name);
 }
 
 void CliInterface::pImpl::createAddTestCommand() {
@@ -163,9 +295,80 @@ void CliInterface::pImpl::createAddTestCommand() {
                     ->take_all()
                     ->allow_extra_args(true);
 
+    auto pch = add_test
+                   ->add_option("--pch",
+                                "Headers to precompile for the test")
+                   ->take_all()
+                   ->allow_extra_args(true);
+
+    auto lto = add_test->add_flag(
+        "--lto", "Enable link time optimization for the test");
+
+    auto unity = add_test->add_flag(
+        "--unity", "Compile the test sources in batches (unity build)");
+
+    auto framework = add_test->add_option(
+        "--framework",
+        "The test framework, to register the test cases one by one to CTest");
+
+    auto labels = add_test->add_option("--labels", "The CTest labels")
+                      ->take_all()
+                      ->allow_extra_args(true);
+
+    auto resource_groups = add_test->add_option(
+        "--resource-groups",
+        "The resources needed by each test case (e.g 2,cpus:1)");
+
     add_test->needs(name);
     std->needs(name);
     deps->needs(name);
+    unity->needs(name);
+    lto->needs(name);
+    pch->needs(name);
+    framework->needs(name);
+    framework->check(CLI::IsMember({"catch2", "gtest", "none"}));
+    labels->needs(name);
+    resource_groups->needs(name);
+}
+
+void CliInterface::pImpl::createAddBenchmarkCommand() {
+    auto add_benchmark = app_.add_subcommand(
+        "add-benchmark", "Add a new Google Benchmark harness to the project");
+
+    add_benchmark->immediate_callback();
+    add_benchmark->parse_complete_callback([this, add_benchmark]() {
+        onAddExecutableOrTest(add_benchmark, benchmarks_);
+    });
+
+    auto name = add_benchmark->add_option("--name", "The benchmark name");
+
+    auto std = add_benchmark->add_option(
+        "--std", "The standard library version to use (e.g 11 for C++11)");
+
+    auto deps = add_benchmark
+                    ->add_option("--dependencies",
+                                 "The benchmark dependencies")
+                    ->take_all()
+                    ->allow_extra_args(true);
+
+    auto pch = add_benchmark
+                   ->add_option("--pch",
+                                "Headers to precompile for the benchmark")
+                   ->take_all()
+                   ->allow_extra_args(true);
+
+    auto lto = add_benchmark->add_flag(
+        "--lto", "Enable link time optimization for the benchmark");
+
+    auto unity = add_benchmark->add_flag(
+        "--unity", "Compile the benchmark sources in batches (unity build)");
+
+    add_benchmark->needs(name);
+    std->needs(name);
+    deps->needs(name);
+    unity->needs(name);
+    lto->needs(name);
+    pch->needs(name);
 }
 
 void CliInterface::pImpl::onAddExecutableOrTest(
@@ -179,6 +382,27 @@ void CliInterface::pImpl::onAddExecutableOrTest(
     params.dependencies = sub_command->get_option("--dependencies")
                               ->as<std::vector<std::string>>();
 
+    params.unity = sub_command->get_option("--unity")->count() > 0;
+    params.lto = sub_command->get_option("--lto")->count() > 0;
+
+    // Only executables can be used for the training
+    if (auto pgo_training =
+            sub_command->get_option_no_throw("--pgo-training")) {
+        params.pgo_training = pgo_training->count() > 0;
+    }
+
+    // Only tests are registered to CTest
+    if (auto framework = sub_command->get_option_no_throw("--framework")) {
+        set_if(framework, params.test_framework);
+        params.test_labels = sub_command->get_option("--labels")
+                                 ->as<std::vector<std::string>>();
+        set_if(sub_command->get_option("--resource-groups"),
+               params.test_resource_groups);
+    }
+
+    params.precompiled_headers =
+        sub_command->get_option("--pch")->as<std::vector<std::string>>();
+
     add_to.emplace_back(params);
 }
 
@@ -209,12 +433,19 @@ void CliInterface::pImpl::createNewProjectCommand() {
 
     auto root_path = new_project->add_option("--root", "The project root path");
 
+    auto pch = new_project
+                   ->add_option("--pch", "Headers to precompile once for all "
+                                         "the components")
+                   ->take_all()
+                   ->allow_extra_args(true);
+
     new_project->needs(name);
     version->needs(name);
     description->needs(name);
     conan_pkgs->needs(name);
     cmake_pkgs->needs(name);
     root_path->needs(name);
+    pch->needs(name);
 }
 
 void CliInterface::pImpl::onNewProject() {
@@ -231,8 +462,51 @@ void CliInterface::pImpl::onNewProject() {
         add_project->get_option("--conan-pkgs")->as<std::vector<std::string>>();
     params.cmake_pkgs =
         add_project->get_option("--cmake-pkgs")->as<std::vector<std::string>>();
+    params.precompiled_headers =
+        add_project->get_option("--pch")->as<std::vector<std::string>>();
 
     project_ = params;
 }
 
-} // namespace cpgen
\ No newline at end of file
+void CliInterface::pImpl::loadManifest() {
+    auto batch = readManifest(manifest_);
+
+    if (batch.project) {
+        if (project_) {
+            throw std::invalid_argument(
+                "A project is already given on the command line");
+        }
+        project_ = std::move(batch.project);
+    }
+
+    auto append = [](auto& to, auto& from) {
+        to.insert(to.end(), std::make_move_iterator(from.begin()),
+                  std::make_move_iterator(from.end()));
+    };
+    append(libraries_, batch.libraries);
+    append(executables_, batch.executables);
+    append(tests_, batch.tests);
+    append(benchmarks_, batch.benchmarks);
+}
+
+void CliInterface::pImpl::checkLibraries() const {
+    for (const auto& library : libraries_) {
+        if (library.type != LibraryType::CxxModule) {
+            continue;
+        }
+        if (library.unity or not library.precompiled_headers.empty()) {
+            throw std::invalid_argument(fmt::format(
+                "The cxx_module library {} can't use unity builds or "
+                "precompiled headers",
+                library.name));
+        }
+        if (not is_valid_module_name(library.name)) {
+            throw std::invalid_argument(fmt::format(
+                "Invalid module name {}: the name of a cxx_module library "
+                "must be identifiers separated by dots",
+                library.name));
+        }
+    }
+}
+
+} // namespace cpgen
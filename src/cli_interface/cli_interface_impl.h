@@ -2,6 +2,7 @@
 
 #include <CLI/CLI.hpp>
 
+#include <string>
 #include <vector>
 
 namespace cpgen {
@@ -13,6 +14,7 @@ public:
     const std::vector<LibraryParameters>& libraries() const;
     const std::vector<ExecutableParameters>& executables() const;
     const std::vector<ExecutableParameters>& tests() const;
+    const std::vector<ExecutableParameters>& benchmarks() const;
     const std::optional<ProjectParameters>& project() const;
     const Options& options() const;
 
@@ -22,18 +24,23 @@ private:
     void onAddLibrary();
     void createAddExecutableCommand();
     void createAddTestCommand();
+    void createAddBenchmarkCommand();
     void onAddExecutableOrTest(CLI::App* sub_command,
                                std::vector<ExecutableParameters>& add_to);
     void createNewProjectCommand();
     void onNewProject();
+    void loadManifest();
+    void checkLibraries() const;
 
     CLI::App app_;
 
     std::vector<LibraryParameters> libraries_;
     std::vector<ExecutableParameters> executables_;
     std::vector<ExecutableParameters> tests_;
+    std::vector<ExecutableParameters> benchmarks_;
     std::optional<ProjectParameters> project_;
     CliInterface::Options options_;
+    std::string manifest_;
 };
 
 } // namespace cpgen
\ No newline at end of file
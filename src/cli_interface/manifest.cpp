@@ -0,0 +1,132 @@
+#include "manifest.h"
+
+#include <fmt/format.h>
+#include <nlohmann/json.hpp>
+
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+using json = nlohmann::json;
+
+template <typename T>
+void set_if(const json& object, const char* key, T& value) {
+    if (object.contains(key)) {
+        object.at(key).get_to(value);
+    }
+}
+
+// Accept both "std": 17 and "std": "17"
+void set_standard(const json& object, std::string& standard) {
+    if (not object.contains("std")) {
+        return;
+    }
+    const auto& value = object.at("std");
+    standard = value.is_number() ? std::to_string(value.get<int>())
+                                 : value.get<std::string>();
+}
+
+cpgen::ProjectParameters parse_project(const json& object) {
+    cpgen::ProjectParameters params;
+    params.name = object.at("name").get<std::string>();
+    set_if(object, "version", params.version);
+    set_if(object, "description", params.description);
+    set_if(object, "root", params.root_path);
+    set_if(object, "conan_pkgs", params.conan_pkgs);
+    set_if(object, "cmake_pkgs", params.cmake_pkgs);
+    set_if(object, "pch", params.precompiled_headers);
+    return params;
+}
+
+cpgen::LibraryParameters parse_library(const json& object) {
+    const auto types = std::map<std::string, cpgen::LibraryType>{
+        {"static", cpgen::LibraryType::Static},
+        {"shared", cpgen::LibraryType::Shared},
+        {"header_only", cpgen::LibraryType::HeaderOnly},
+        {"module", cpgen::LibraryType::Module},
+        {"cxx_module", cpgen::LibraryType::CxxModule}};
+
+    cpgen::LibraryParameters params;
+    params.name = object.at("name").get<std::string>();
+    if (object.contains("type")) {
+        const auto type = object.at("type").get<std::string>();
+        if (auto it = types.find(type); it != types.end()) {
+            params.type = it->second;
+        } else {
+            throw std::runtime_error(fmt::format(
+                "Invalid type {} for library {}", type, params.name));
+        }
+    }
+    set_standard(object, params.standard);
+    set_if(object, "dependencies", params.dependencies);
+    set_if(object, "unity", params.unity);
+    set_if(object, "lto", params.lto);
+    set_if(object, "pch", params.precompiled_headers);
+    return params;
+}
+
+cpgen::ExecutableParameters parse_executable(const json& object) {
+    cpgen::ExecutableParameters params;
+    params.name = object.at("name").get<std::string>();
+    set_standard(object, params.standard);
+    set_if(object, "dependencies", params.dependencies);
+    set_if(object, "unity", params.unity);
+    set_if(object, "lto", params.lto);
+    set_if(object, "pch", params.precompiled_headers);
+    set_if(object, "pgo_training", params.pgo_training);
+    set_if(object, "framework", params.test_framework);
+    if (params.test_framework != "catch2" and
+        params.test_framework != "gtest" and params.test_framework != "none") {
+        throw std::runtime_error(
+            fmt::format("Invalid framework {} for {}", params.test_framework,
+                        params.name));
+    }
+    set_if(object, "labels", params.test_labels);
+    set_if(object, "resource_groups", params.test_resource_groups);
+    return params;
+}
+
+} // namespace
+
+namespace cpgen {
+
+BatchParameters readManifest(const std::filesystem::path& file) {
+    std::ifstream input(file);
+    if (not input) {
+        throw std::runtime_error(
+            fmt::format("Failed to open the manifest {}", file.native()));
+    }
+
+    try {
+        const auto manifest = json::parse(input);
+
+        BatchParameters batch;
+        if (manifest.contains("project")) {
+            batch.project = parse_project(manifest.at("project"));
+        }
+        for (const auto& library : manifest.value("libraries", json::array())) {
+            batch.libraries.push_back(parse_library(library));
+        }
+        for (const auto& executable :
+             manifest.value("executables", json::array())) {
+            batch.executables.push_back(parse_executable(executable));
+        }
+        for (const auto& test : manifest.value("tests", json::array())) {
+            batch.tests.push_back(parse_executable(test));
+        }
+        for (const auto& benchmark :
+             manifest.value("benchmarks", json::array())) {
+            batch.benchmarks.push_back(parse_executable(benchmark));
+        }
+        return batch;
+    } catch (const json::exception& error) {
+        throw std::runtime_error(fmt::format("Invalid manifest {}: {}",
+                                             file.native(), error.what()));
+    }
+}
+
+} // namespace cpgen
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cpgen/common.h>
+
+#include <filesystem>
+
+namespace cpgen {
+
+// Reads a JSON file describing a project and/or its components, e.g:
+// {
+//     "project": { "name": "foo", "conan_pkgs": ["fmt/7.1.2"] },
+//     "libraries": [ { "name": "bar", "type": "shared", "std": "17" } ],
+//     "executables": [ { "name": "baz", "dependencies": ["bar"] } ],
+//     "tests": [ { "name": "bar-test", "dependencies": ["bar"] } ]
+// }
+// The fields are named after the matching command line options. Throws
+// std::runtime_error if the file can't be read or is invalid
+BatchParameters readManifest(const std::filesystem::path& file);
+
+} // namespace cpgen
@@ -0,0 +1,284 @@
+#include "output_sink.h"
+
+#include <fmt/format.h>
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
+
+namespace {
+
+bool write_all(int fd, const std::string& content) {
+    std::size_t written{0};
+    while (written < content.size()) {
+        const auto result =
+            write(fd, content.data() + written, content.size() - written);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        written += static_cast<std::size_t>(result);
+    }
+    return true;
+}
+
+mode_t to_mode(std::filesystem::perms permissions) {
+    return permissions == std::filesystem::perms::unknown
+               ? mode_t{0644}
+               : static_cast<mode_t>(permissions &
+                                     std::filesystem::perms::mask);
+}
+
+// Copies the source content to the output file. A reflink shares the data
+// blocks on filesystems supporting it (btrfs, xfs), then copy_file_range
+// copies the data inside the kernel. Only if both fail is the data read back
+// to user space. Returns false and sets errno on failure
+bool copy_content(int input, int output) {
+#if defined(__linux__)
+    if (ioctl(output, FICLONE, input) == 0) {
+        return true;
+    }
+
+    for (;;) {
+        const auto copied = copy_file_range(input, nullptr, output, nullptr,
+                                            std::size_t{1} << 30, 0);
+        if (copied == 0) {
+            return true;
+        }
+        if (copied < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // Not supported for this pair of files, e.g across filesystems on
+            // older kernels, so use a plain copy for what is left
+            if (errno == EXDEV or errno == ENOSYS or errno == EINVAL or
+                errno == EOPNOTSUPP) {
+                break;
+            }
+            return false;
+        }
+    }
+#endif
+
+    std::vector<char> buffer(std::size_t{64} << 10);
+    for (;;) {
+        const auto size = read(input, buffer.data(), buffer.size());
+        if (size == 0) {
+            return true;
+        }
+        if (size < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        std::size_t written{0};
+        while (written < static_cast<std::size_t>(size)) {
+            const auto result = write(output, buffer.data() + written,
+                                      static_cast<std::size_t>(size) - written);
+            if (result < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            written += static_cast<std::size_t>(result);
+        }
+    }
+}
+
+// Creates path as a copy of source. Existing files are left untouched.
+// chmod is only called if the umask strips some of the permissions. Returns
+// false on failure, after printing why
+bool clone_file(const std::string& source, const std::string& path,
+                mode_t mode, mode_t mask) {
+    const auto input = open(source.c_str(), O_RDONLY | O_CLOEXEC);
+    if (input < 0) {
+        fmt::print(stderr, "Failed to open {}: {}\n", source,
+                   std::strerror(errno));
+        return false;
+    }
+
+    const auto output =
+        open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, mode);
+    if (output < 0) {
+        const auto error = errno;
+        close(input);
+        if (error != EEXIST) {
+            fmt::print(stderr, "Failed to create {}: {}\n", path,
+                       std::strerror(error));
+            return false;
+        }
+        return true;
+    }
+
+    bool all_ok{true};
+    if (not copy_content(input, output)) {
+        fmt::print(stderr, "Failed to copy {} to {}: {}\n", source, path,
+                   std::strerror(errno));
+        all_ok = false;
+    }
+    if ((mode & mask) != 0) {
+        fchmod(output, mode);
+    }
+    close(output);
+    close(input);
+    return all_ok;
+}
+
+mode_t current_umask() {
+    const auto mask = umask(0);
+    umask(mask);
+    return mask;
+}
+
+} // namespace
+
+namespace cpgen {
+
+bool FilesystemSink::exists(const std::filesystem::path& path) const {
+    return std::filesystem::exists(path);
+}
+
+void FilesystemSink::createDirectories(const std::filesystem::path& path) {
+    std::filesystem::create_directories(path);
+}
+
+void FilesystemSink::writeFile(const std::filesystem::path& path,
+                               std::string content,
+                               std::filesystem::perms permissions) {
+    std::ofstream output(path.native(), std::ios::binary);
+    output << content;
+    output.close();
+    if (not output) {
+        fmt::print(stderr, "Failed to write {}: {}\n", path.native(),
+                   std::strerror(errno));
+        all_ok_ = false;
+        return;
+    }
+    std::filesystem::permissions(path, permissions);
+}
+
+void FilesystemSink::copyFile(const std::filesystem::path& source,
+                              const std::filesystem::path& path,
+                              std::filesystem::perms permissions) {
+    // Called concurrently so the umask can't be queried here. Assume it strips
+    // something to always get the requested permissions
+    if (not clone_file(source.native(), path.native(), to_mode(permissions),
+                       static_cast<mode_t>(07777))) {
+        all_ok_ = false;
+    }
+}
+
+bool FilesystemSink::flush() {
+    // Reset for the next generation
+    return all_ok_.exchange(true);
+}
+
+bool MemorySink::exists(const std::filesystem::path& path) const {
+    {
+        std::lock_guard lock{mutex_};
+        if (entries_.contains(path.native())) {
+            return true;
+        }
+    }
+    return std::filesystem::exists(path);
+}
+
+void MemorySink::createDirectories(const std::filesystem::path& path) {
+    std::lock_guard lock{mutex_};
+    entries_[path.native()].is_directory = true;
+}
+
+void MemorySink::writeFile(const std::filesystem::path& path,
+                           std::string content,
+                           std::filesystem::perms permissions) {
+    std::lock_guard lock{mutex_};
+    entries_[path.native()] =
+        Entry{false, permissions, std::move(content), {}};
+}
+
+void MemorySink::copyFile(const std::filesystem::path& source,
+                          const std::filesystem::path& path,
+                          std::filesystem::perms permissions) {
+    std::lock_guard lock{mutex_};
+    entries_[path.native()] = Entry{false, permissions, {}, source.native()};
+}
+
+const std::map<std::string, MemorySink::Entry>& MemorySink::entries() const {
+    return entries_;
+}
+
+void MemorySink::clear() {
+    std::lock_guard lock{mutex_};
+    entries_.clear();
+}
+
+bool BatchedSink::flush() {
+    namespace fs = std::filesystem;
+
+    // The permissions are given to open() to avoid a chmod per file, which
+    // is only needed if the umask would remove some of them
+    const auto mask = current_umask();
+
+    bool all_ok{true};
+    for (const auto& [path, entry] : entries_) {
+        if (entry.is_directory) {
+            // Parents come first so a single mkdir is enough, unless a parent
+            // was not part of the generated tree
+            if (mkdir(path.c_str(), 0777) != 0 and errno != EEXIST) {
+                std::error_code error;
+                fs::create_directories(fs::path{path}, error);
+                if (error) {
+                    fmt::print(stderr, "Failed to create {}: {}\n", path,
+                               error.message());
+                    all_ok = false;
+                }
+            }
+            continue;
+        }
+
+        const auto mode = to_mode(entry.permissions);
+        if (not entry.source.empty()) {
+            all_ok &= clone_file(entry.source, path, mode, mask);
+            continue;
+        }
+
+        // O_EXCL leaves the files created in the meantime untouched
+        const auto fd =
+            open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, mode);
+        if (fd < 0) {
+            if (errno != EEXIST) {
+                fmt::print(stderr, "Failed to create {}: {}\n", path,
+                           std::strerror(errno));
+                all_ok = false;
+            }
+            continue;
+        }
+        if (not write_all(fd, entry.content)) {
+            fmt::print(stderr, "Failed to write {}: {}\n", path,
+                       std::strerror(errno));
+            all_ok = false;
+        }
+        if ((mode & mask) != 0) {
+            fchmod(fd, mode);
+        }
+        close(fd);
+    }
+
+    entries_.clear();
+    return all_ok;
+}
+
+} // namespace cpgen
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace cpgen {
+
+// Receives the generated directories and files. All the functions can be
+// called concurrently except flush()
+class OutputSink {
+public:
+    virtual ~OutputSink() = default;
+
+    // Existing files are never overwritten so they don't have to be rendered
+    virtual bool exists(const std::filesystem::path& path) const = 0;
+
+    virtual void createDirectories(const std::filesystem::path& path) = 0;
+
+    virtual void writeFile(const std::filesystem::path& path,
+                           std::string content,
+                           std::filesystem::perms permissions) = 0;
+
+    // Copies the file, ideally without reading it (reflink or in-kernel copy)
+    virtual void copyFile(const std::filesystem::path& source,
+                          const std::filesystem::path& path,
+                          std::filesystem::perms permissions) = 0;
+
+    // Called once a generation is complete. Returns false on failure
+    virtual bool flush() {
+        return true;
+    }
+};
+
+// Writes everything to the filesystem right away. The failures are reported
+// by flush()
+class FilesystemSink : public OutputSink {
+public:
+    bool exists(const std::filesystem::path& path) const override;
+
+    void createDirectories(const std::filesystem::path& path) override;
+
+    void writeFile(const std::filesystem::path& path, std::string content,
+                   std::filesystem::perms permissions) override;
+
+    void copyFile(const std::filesystem::path& source,
+                  const std::filesystem::path& path,
+                  std::filesystem::perms permissions) override;
+
+    bool flush() override;
+
+private:
+    std::atomic<bool> all_ok_{true};
+};
+
+// Keeps the generated tree in memory. Files already on disk are still
+// considered as existing so that the tree is the one that would be written
+class MemorySink : public OutputSink {
+public:
+    struct Entry {
+        bool is_directory{false};
+        std::filesystem::perms permissions{std::filesystem::perms::unknown};
+        std::string content;
+        // Set instead of the content for the copied files
+        std::string source;
+    };
+
+    bool exists(const std::filesystem::path& path) const override;
+
+    void createDirectories(const std::filesystem::path& path) override;
+
+    void writeFile(const std::filesystem::path& path, std::string content,
+                   std::filesystem::perms permissions) override;
+
+    void copyFile(const std::filesystem::path& source,
+                  const std::filesystem::path& path,
+                  std::filesystem::perms permissions) override;
+
+    // Native paths, sorted so that directories come before their content
+    const std::map<std::string, Entry>& entries() const;
+
+    void clear();
+
+protected:
+    std::map<std::string, Entry> entries_;
+    mutable std::mutex mutex_;
+};
+
+// Collects the generated tree in memory and writes it all at once on flush(),
+// with a single open/write/close sequence per file and one mkdir per
+// directory
+class BatchedSink : public MemorySink {
+public:
+    bool flush() override;
+};
+
+} // namespace cpgen
@@ -0,0 +1,189 @@
+#include "pattern_replacer.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+constexpr std::string_view delimiter{"__"};
+
+bool is_key_character(char c) {
+    return (c >= 'a' and c <= 'z') or (c >= 'A' and c <= 'Z') or
+           (c >= '0' and c <= '9') or c == '_';
+}
+
+bool is_valid_key(std::string_view key) {
+    return not key.empty() and
+           key.size() <= cpgen::PatternReplacer::max_placeholder_key_length and
+           std::all_of(begin(key), end(key), is_key_character);
+}
+
+} // namespace
+
+namespace cpgen {
+
+PatternReplacer::PatternReplacer(
+    const std::map<std::string, std::string>& dictionnary,
+    SubstitutionEngine engine)
+    : engine_{engine} {
+    switch (engine_) {
+    case SubstitutionEngine::Scanner:
+        use_placeholders_ = true;
+        for (const auto& [from, to] : dictionnary) {
+            dictionnary_.emplace(from, to);
+            max_key_length_ = std::max(max_key_length_, from.size());
+            use_placeholders_ &= is_valid_key(from);
+        }
+        break;
+    case SubstitutionEngine::Regex:
+        any_pattern_ = std::regex("__.*__");
+        for (const auto& [from, to] : dictionnary) {
+            patterns_.emplace_back(std::regex(fmt::format("__{}__", from)), to);
+        }
+        break;
+    }
+}
+
+std::optional<std::string>
+PatternReplacer::replace(std::string_view input) const {
+    switch (engine_) {
+    case SubstitutionEngine::Scanner:
+        return scannerReplace(input);
+    case SubstitutionEngine::Regex:
+        return regexReplace(input);
+    }
+    return std::nullopt; // fix missing return warning
+}
+
+bool PatternReplacer::isVerbatim(
+    const std::vector<Placeholder>& placeholders) const {
+    return use_placeholders_ and placeholders.empty();
+}
+
+std::optional<std::string>
+PatternReplacer::replace(std::string_view input,
+                         const std::vector<Placeholder>& placeholders) const {
+    // findPlaceholders() skips keys that can't be in the dictionnary, so fall
+    // back to a full scan if the dictionnary has such keys
+    if (not use_placeholders_) {
+        return replace(input);
+    }
+
+    std::optional<std::string> output;
+    std::size_t copied{0};
+
+    for (const auto& placeholder : placeholders) {
+        if (placeholder.offset < copied) {
+            continue;
+        }
+        // Stale placeholders (e.g the file changed since they were computed)
+        // can't be trusted
+        const auto closing_delimiter =
+            std::size_t{placeholder.offset} + delimiter.size() +
+            placeholder.key_length;
+        if (closing_delimiter + delimiter.size() > input.size() or
+            input.substr(placeholder.offset, delimiter.size()) != delimiter or
+            input.substr(closing_delimiter, delimiter.size()) != delimiter) {
+            return replace(input);
+        }
+
+        const auto key = input.substr(placeholder.offset + delimiter.size(),
+                                      placeholder.key_length);
+        const auto value = dictionnary_.find(std::string{key});
+        if (value != end(dictionnary_)) {
+            if (not output) {
+                output.emplace();
+                output->reserve(input.size());
+            }
+            output->append(input.substr(copied, placeholder.offset - copied));
+            output->append(value->second);
+            copied = closing_delimiter + delimiter.size();
+        }
+    }
+
+    if (output) {
+        output->append(input.substr(copied));
+    }
+    return output;
+}
+
+std::vector<Placeholder>
+PatternReplacer::findPlaceholders(std::string_view input) {
+    // Record every opening delimiter followed by a valid key and a closing
+    // delimiter, including overlapping ones (e.g both in ___key__), so that
+    // replace() can apply the same leftmost-first rule as the scanner for any
+    // dictionnary
+    std::vector<Placeholder> placeholders;
+    auto pos = input.find(delimiter);
+    while (pos != std::string_view::npos) {
+        const auto key_begin = pos + delimiter.size();
+        const auto window =
+            input.substr(std::min(key_begin, input.size()),
+                         max_placeholder_key_length + delimiter.size());
+        const auto key_length = window.find(delimiter);
+        if (key_length != std::string_view::npos and
+            is_valid_key(window.substr(0, key_length))) {
+            placeholders.push_back(
+                Placeholder{static_cast<std::uint32_t>(pos),
+                            static_cast<std::uint32_t>(key_length)});
+        }
+        pos = input.find(delimiter, pos + 1);
+    }
+    return placeholders;
+}
+
+std::optional<std::string>
+PatternReplacer::scannerReplace(std::string_view input) const {
+    std::optional<std::string> output;
+    std::size_t copied{0};
+
+    // For each delimiter, look for a known key followed by another delimiter.
+    // Keys longer than the longest dictionnary key can't match so the closing
+    // delimiter search is bounded, making the whole pass linear
+    auto pos = input.find(delimiter);
+    while (pos != std::string_view::npos) {
+        const auto key_begin = pos + delimiter.size();
+        const auto window =
+            input.substr(std::min(key_begin, input.size()),
+                         max_key_length_ + delimiter.size());
+        const auto key_length = window.find(delimiter);
+        if (key_length != std::string_view::npos) {
+            const auto value =
+                dictionnary_.find(std::string{window.substr(0, key_length)});
+            if (value != end(dictionnary_)) {
+                if (not output) {
+                    output.emplace();
+                    output->reserve(input.size());
+                }
+                output->append(input.substr(copied, pos - copied));
+                output->append(value->second);
+                copied = key_begin + key_length + delimiter.size();
+                pos = input.find(delimiter, copied);
+                continue;
+            }
+        }
+        pos = input.find(delimiter, pos + 1);
+    }
+
+    if (output) {
+        output->append(input.substr(copied));
+    }
+    return output;
+}
+
+std::optional<std::string>
+PatternReplacer::regexReplace(std::string_view input) const {
+    if (not std::regex_search(begin(input), end(input), any_pattern_)) {
+        return std::nullopt;
+    }
+
+    std::string output{input};
+    for (const auto& [pattern, value] : patterns_) {
+        output = std::regex_replace(output, pattern, value);
+    }
+    return output;
+}
+
+} // namespace cpgen
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cpgen/common.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace cpgen {
+
+// Potential __key__ placeholder found in a buffer
+struct Placeholder {
+    // Position of the opening delimiter
+    std::uint32_t offset{};
+    std::uint32_t key_length{};
+};
+
+// Substitutes the __key__ placeholders found in a buffer with the matching
+// dictionnary values. The dictionnary is compiled once at construction so
+// that each buffer is processed in a single pass with the Scanner engine. The
+// Regex engine reproduces the original per-key std::regex_replace behavior.
+// Both give the same result on the shipped templates but differ on corner
+// cases: the Scanner inserts the values literally while std::regex_replace
+// interprets $& or $1 in them, and the Scanner substitutes the leftmost
+// placeholder first, once, while the Regex engine substitutes each key in turn
+// over the whole buffer. Overlapping placeholders (e.g ___name__key__) and
+// values holding placeholders are thus handled differently.
+class PatternReplacer {
+public:
+    PatternReplacer(const std::map<std::string, std::string>& dictionnary,
+                    SubstitutionEngine engine);
+
+    // Keys longer than this are never reported by findPlaceholders()
+    static constexpr std::size_t max_placeholder_key_length = 64;
+
+    // Returns std::nullopt if the input doesn't contain any placeholder
+    std::optional<std::string> replace(std::string_view input) const;
+
+    // Same as replace(input) but only considers the given placeholders, as
+    // returned by findPlaceholders(input), instead of scanning the input
+    std::optional<std::string>
+    replace(std::string_view input,
+            const std::vector<Placeholder>& placeholders) const;
+
+    // Lists everything that looks like a placeholder in the input,
+    // independently of any dictionnary, so that the result can be computed
+    // once and reused for all the subsequent replacements
+    static std::vector<Placeholder> findPlaceholders(std::string_view input);
+
+    // True if an input with these placeholders is known to be left unchanged,
+    // without having to read it
+    bool isVerbatim(const std::vector<Placeholder>& placeholders) const;
+
+private:
+    std::optional<std::string> scannerReplace(std::string_view input) const;
+    std::optional<std::string> regexReplace(std::string_view input) const;
+
+    SubstitutionEngine engine_;
+
+    std::unordered_map<std::string, std::string> dictionnary_;
+    std::size_t max_key_length_{};
+    bool use_placeholders_{false};
+
+    std::regex any_pattern_;
+    std::vector<std::pair<std::regex, std::string>> patterns_;
+};
+
+} // namespace cpgen
@@ -0,0 +1,139 @@
+#include "project_marker.h"
+
+#include <fmt/format.h>
+
+#include <charconv>
+#include <fstream>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+// One record per line, with tab separated fields:
+//   cpgen <version>
+//   component <name> <template root>
+//   value <component name> <key> <value>
+//   file <path> <component name> <entry> <template hash> <content hash>
+// Tabs, new lines and backslashes are escaped in the fields
+constexpr std::string_view header{"cpgen"};
+
+std::string escape(std::string_view field) {
+    std::string escaped;
+    escaped.reserve(field.size());
+    for (const auto c : field) {
+        switch (c) {
+        case '\\':
+            escaped += "\\\\";
+            break;
+        case '\t':
+            escaped += "\\t";
+            break;
+        case '\n':
+            escaped += "\\n";
+            break;
+        default:
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+std::vector<std::string> split_fields(std::string_view line) {
+    std::vector<std::string> fields(1);
+    for (std::size_t i = 0; i < line.size(); i++) {
+        if (line[i] == '\t') {
+            fields.emplace_back();
+        } else if (line[i] == '\\' and i + 1 < line.size()) {
+            const auto c = line[++i];
+            fields.back() += c == 't' ? '\t' : c == 'n' ? '\n' : c;
+        } else {
+            fields.back() += line[i];
+        }
+    }
+    return fields;
+}
+
+bool parse_hash(const std::string& field, std::uint64_t& hash) {
+    const auto end = field.data() + field.size();
+    const auto [ptr, error] = std::from_chars(field.data(), end, hash, 16);
+    return error == std::errc{} and ptr == end;
+}
+
+} // namespace
+
+namespace cpgen {
+
+std::optional<ProjectMarker>
+ProjectMarker::load(const std::filesystem::path& file) {
+    std::ifstream input(file.native());
+    if (not input) {
+        return std::nullopt;
+    }
+
+    ProjectMarker marker;
+    std::string line;
+    if (not std::getline(input, line)) {
+        return marker;
+    }
+    if (line != fmt::format("{}\t{}", header, format_version)) {
+        return std::nullopt;
+    }
+
+    while (std::getline(input, line)) {
+        const auto fields = split_fields(line);
+        const auto& type = fields.front();
+        if (type == "component" and fields.size() == 3) {
+            marker.components[fields[1]].template_root = fields[2];
+        } else if (type == "value" and fields.size() == 4) {
+            marker.components[fields[1]].dictionnary[fields[2]] = fields[3];
+        } else if (type == "file" and fields.size() == 6) {
+            GeneratedFile generated{fields[2], fields[3]};
+            if (not parse_hash(fields[4], generated.template_hash) or
+                not parse_hash(fields[5], generated.content_hash)) {
+                return std::nullopt;
+            }
+            marker.files[fields[1]] = std::move(generated);
+        } else {
+            return std::nullopt;
+        }
+    }
+    return marker;
+}
+
+bool ProjectMarker::save(const std::filesystem::path& file) const {
+    auto tmp_file = file;
+    tmp_file += ".tmp";
+    {
+        std::ofstream output(tmp_file.native(), std::ios::trunc);
+        if (not output) {
+            return false;
+        }
+
+        output << fmt::format("{}\t{}\n", header, format_version);
+        for (const auto& [name, component] : components) {
+            output << fmt::format("component\t{}\t{}\n", escape(name),
+                                  escape(component.template_root));
+            for (const auto& [key, value] : component.dictionnary) {
+                output << fmt::format("value\t{}\t{}\t{}\n", escape(name),
+                                      escape(key), escape(value));
+            }
+        }
+        for (const auto& [path, generated] : files) {
+            output << fmt::format("file\t{}\t{}\t{}\t{:x}\t{:x}\n",
+                                  escape(path), escape(generated.component),
+                                  escape(generated.entry),
+                                  generated.template_hash,
+                                  generated.content_hash);
+        }
+
+        if (not output) {
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tmp_file, file, error);
+    return not error;
+}
+
+} // namespace cpgen
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+
+namespace cpgen {
+
+// Content of the .cpgen file marking the root of a generated project. It
+// records the components generated in the project and, for each generated
+// file, the hash of the template it was rendered from and of the content that
+// was written. This is what allows to upgrade a project when the templates
+// change without touching the files modified since
+struct ProjectMarker {
+    // Increment each time the format changes
+    static constexpr int format_version = 1;
+
+    struct Component {
+        // Relative to the templates root (e.g library/static_shared)
+        std::string template_root;
+        std::map<std::string, std::string> dictionnary;
+    };
+
+    struct GeneratedFile {
+        // Name of the component which generated the file
+        std::string component;
+        // Relative to the component template root
+        std::string entry;
+        std::uint64_t template_hash{};
+        std::uint64_t content_hash{};
+    };
+
+    static std::filesystem::path path(const std::filesystem::path& root) {
+        return root / ".cpgen";
+    }
+
+    // An empty marker, as created by the project template, gives an empty
+    // ProjectMarker. Returns std::nullopt if the file cannot be read or is
+    // invalid
+    static std::optional<ProjectMarker>
+    load(const std::filesystem::path& file);
+
+    // Returns false if the file cannot be written
+    bool save(const std::filesystem::path& file) const;
+
+    // Keyed by component name (e.g "library greeter")
+    std::map<std::string, Component> components;
+    // Keyed by generic path relative to the project root
+    std::map<std::string, GeneratedFile> files;
+};
+
+} // namespace cpgen
@@ -0,0 +1,148 @@
+#include "sha256.h"
+
+#include <fstream>
+#include <vector>
+
+namespace {
+
+constexpr std::array<std::uint32_t, 64> round_constants{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+constexpr std::uint32_t rotr(std::uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+} // namespace
+
+namespace cpgen {
+
+Sha256::Sha256()
+    : state_{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+             0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19} {
+}
+
+void Sha256::update(const void* data, std::size_t size) {
+    auto bytes = static_cast<const std::uint8_t*>(data);
+    total_size_ += size;
+
+    if (buffer_size_ > 0) {
+        while (size > 0 and buffer_size_ < buffer_.size()) {
+            buffer_[buffer_size_++] = *bytes++;
+            --size;
+        }
+        if (buffer_size_ < buffer_.size()) {
+            return;
+        }
+        processBlock(buffer_.data());
+        buffer_size_ = 0;
+    }
+
+    for (; size >= buffer_.size(); size -= buffer_.size()) {
+        processBlock(bytes);
+        bytes += buffer_.size();
+    }
+
+    while (size > 0) {
+        buffer_[buffer_size_++] = *bytes++;
+        --size;
+    }
+}
+
+std::string Sha256::hexDigest() {
+    const std::uint64_t total_bits = total_size_ * 8;
+
+    const std::uint8_t padding_start = 0x80;
+    update(&padding_start, 1);
+    const std::uint8_t zero = 0;
+    while (buffer_size_ != 56) {
+        update(&zero, 1);
+    }
+    std::array<std::uint8_t, 8> length;
+    for (std::size_t i = 0; i < length.size(); i++) {
+        length[i] = static_cast<std::uint8_t>(total_bits >> (56 - 8 * i));
+    }
+    update(length.data(), length.size());
+
+    constexpr char digits[] = "0123456789abcdef";
+    std::string digest;
+    digest.reserve(64);
+    for (auto word : state_) {
+        for (int shift = 28; shift >= 0; shift -= 4) {
+            digest.push_back(digits[(word >> shift) & 0xf]);
+        }
+    }
+    return digest;
+}
+
+std::string Sha256::hashFile(const std::filesystem::path& file) {
+    std::ifstream input(file.native(), std::ios::binary);
+    if (not input) {
+        return {};
+    }
+
+    Sha256 sha;
+    std::vector<char> buffer(65536);
+    while (input.read(buffer.data(), static_cast<std::streamsize>(
+                                         buffer.size())) or
+           input.gcount() > 0) {
+        sha.update(buffer.data(), static_cast<std::size_t>(input.gcount()));
+    }
+    return sha.hexDigest();
+}
+
+void Sha256::processBlock(const std::uint8_t* block) {
+    std::array<std::uint32_t, 64> w;
+    for (std::size_t i = 0; i < 16; i++) {
+        w[i] = (std::uint32_t{block[4 * i]} << 24) |
+               (std::uint32_t{block[4 * i + 1]} << 16) |
+               (std::uint32_t{block[4 * i + 2]} << 8) |
+               std::uint32_t{block[4 * i + 3]};
+    }
+    for (std::size_t i = 16; i < 64; i++) {
+        const auto s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^
+                        (w[i - 15] >> 3);
+        const auto s1 =
+            rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    auto [a, b, c, d, e, f, g, h] = state_;
+    for (std::size_t i = 0; i < 64; i++) {
+        const auto s1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+        const auto ch = (e & f) ^ (~e & g);
+        const auto temp1 = h + s1 + ch + round_constants[i] + w[i];
+        const auto s0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+        const auto maj = (a & b) ^ (a & c) ^ (b & c);
+        const auto temp2 = s0 + maj;
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + temp1;
+        d = c;
+        c = b;
+        b = a;
+        a = temp1 + temp2;
+    }
+
+    state_[0] += a;
+    state_[1] += b;
+    state_[2] += c;
+    state_[3] += d;
+    state_[4] += e;
+    state_[5] += f;
+    state_[6] += g;
+    state_[7] += h;
+}
+
+} // namespace cpgen
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+namespace cpgen {
+
+// Minimal SHA-256 implementation (FIPS 180-4) used to identify the content of
+// the downloaded templates
+class Sha256 {
+public:
+    Sha256();
+
+    void update(const void* data, std::size_t size);
+
+    // Finalizes the hash and returns it as a lowercase hexadecimal string
+    std::string hexDigest();
+
+    // Returns an empty string if the file cannot be read
+    static std::string hashFile(const std::filesystem::path& file);
+
+private:
+    void processBlock(const std::uint8_t* block);
+
+    std::array<std::uint32_t, 8> state_;
+    std::array<std::uint8_t, 64> buffer_{};
+    std::size_t buffer_size_{};
+    std::uint64_t total_size_{};
+};
+
+} // namespace cpgen
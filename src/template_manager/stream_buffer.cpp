@@ -0,0 +1,64 @@
+#include "stream_buffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace cpgen {
+
+StreamBuffer::StreamBuffer(std::size_t capacity) : buffer_(capacity) {
+}
+
+bool StreamBuffer::write(const void* data, std::size_t size) {
+    auto bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        std::unique_lock lock{mutex_};
+        can_write_.wait(lock,
+                        [this] { return closed_ or size_ < buffer_.size(); });
+        if (closed_) {
+            return false;
+        }
+
+        const auto end = (begin_ + size_) % buffer_.size();
+        const auto count =
+            std::min({size, buffer_.size() - size_, buffer_.size() - end});
+        std::memcpy(buffer_.data() + end, bytes, count);
+        size_ += count;
+        bytes += count;
+        size -= count;
+
+        lock.unlock();
+        can_read_.notify_one();
+    }
+    return true;
+}
+
+std::size_t StreamBuffer::read(void* data, std::size_t max_size) {
+    std::unique_lock lock{mutex_};
+    can_read_.wait(lock, [this] { return closed_ or size_ > 0; });
+
+    const auto count = std::min({max_size, size_, buffer_.size() - begin_});
+    std::memcpy(data, buffer_.data() + begin_, count);
+    begin_ = (begin_ + count) % buffer_.size();
+    size_ -= count;
+
+    lock.unlock();
+    can_write_.notify_one();
+    return count;
+}
+
+bool StreamBuffer::waitForData() {
+    std::unique_lock lock{mutex_};
+    can_read_.wait(lock, [this] { return closed_ or size_ > 0; });
+    return size_ > 0;
+}
+
+void StreamBuffer::close() {
+    {
+        std::lock_guard lock{mutex_};
+        closed_ = true;
+    }
+    can_read_.notify_all();
+    can_write_.notify_all();
+}
+
+} // namespace cpgen
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace cpgen {
+
+// Fixed size ring buffer connecting a producer thread to a consumer thread.
+// The producer blocks when the buffer is full and the consumer when it is
+// empty, so the memory usage doesn't depend on the amount of data streamed
+class StreamBuffer {
+public:
+    explicit StreamBuffer(std::size_t capacity);
+
+    // Blocks until all the data is written. Returns false if the consumer
+    // closed the stream
+    bool write(const void* data, std::size_t size);
+
+    // Blocks until some data is available. Returns the number of bytes read,
+    // 0 once the stream is closed and all its data consumed
+    std::size_t read(void* data, std::size_t max_size);
+
+    // Blocks until some data is available or the stream is closed. Returns
+    // true if there is data to read
+    bool waitForData();
+
+    // Called by either side to signal the end of the stream. Pending data can
+    // still be read
+    void close();
+
+private:
+    std::vector<char> buffer_;
+    std::size_t begin_{};
+    std::size_t size_{};
+    bool closed_{false};
+
+    mutable std::mutex mutex_;
+    std::condition_variable can_read_;
+    std::condition_variable can_write_;
+};
+
+} // namespace cpgen
@@ -0,0 +1,296 @@
+#include "template_index.h"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <string_view>
+#include <type_traits>
+#include <unistd.h>
+
+namespace {
+
+constexpr std::string_view magic{"CPGENIDX"};
+
+constexpr std::uint64_t fnv_offset_basis = 14695981039346656037ull;
+constexpr std::uint64_t fnv_prime = 1099511628211ull;
+
+std::uint64_t fnv1a(std::uint64_t hash, std::string_view data) {
+    for (const auto c : data) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= fnv_prime;
+    }
+    return hash;
+}
+
+constexpr std::uint8_t directory_flag = 1;
+constexpr std::uint8_t verbatim_flag = 2;
+
+template <typename T> void write(std::ostream& output, T value) {
+    static_assert(std::is_integral_v<T>);
+    output.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void write(std::ostream& output, std::string_view value) {
+    write(output, static_cast<std::uint32_t>(value.size()));
+    output.write(value.data(), static_cast<std::streamsize>(value.size()));
+}
+
+void write(std::ostream& output,
+           const std::vector<cpgen::Placeholder>& placeholders) {
+    write(output, static_cast<std::uint32_t>(placeholders.size()));
+    for (const auto& placeholder : placeholders) {
+        write(output, placeholder.offset);
+        write(output, placeholder.key_length);
+    }
+}
+
+template <typename T> bool read(std::istream& input, T& value) {
+    static_assert(std::is_integral_v<T>);
+    return static_cast<bool>(
+        input.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+bool read(std::istream& input, std::string& value) {
+    std::uint32_t size{};
+    if (not read(input, size)) {
+        return false;
+    }
+    value.resize(size);
+    return static_cast<bool>(input.read(value.data(), size));
+}
+
+bool read(std::istream& input, std::vector<cpgen::Placeholder>& placeholders) {
+    std::uint32_t count{};
+    if (not read(input, count)) {
+        return false;
+    }
+    placeholders.resize(count);
+    for (auto& placeholder : placeholders) {
+        if (not read(input, placeholder.offset) or
+            not read(input, placeholder.key_length)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+namespace cpgen {
+
+TemplateIndex TemplateIndex::build(const TemplateSource& source,
+                                   std::uint64_t templates_hash) {
+    TemplateIndex index;
+    index.templates_hash_ = templates_hash;
+    for (auto& entry : source.entries({})) {
+        entry.path_placeholders =
+            PatternReplacer::findPlaceholders(entry.path.native());
+        if (not entry.is_directory) {
+            const auto content = source.content({}, entry);
+            entry.placeholders = PatternReplacer::findPlaceholders(content);
+            entry.content_hash = hash(content);
+        }
+        auto path = entry.path.generic_string();
+        index.entries_.emplace(std::move(path), std::move(entry));
+    }
+    return index;
+}
+
+std::optional<TemplateIndex>
+TemplateIndex::load(const std::filesystem::path& file,
+                    std::uint64_t templates_hash) {
+    std::ifstream input(file.native(), std::ios::binary);
+    if (not input) {
+        return std::nullopt;
+    }
+
+    std::array<char, magic.size()> file_magic{};
+    std::uint32_t version{};
+    TemplateIndex index;
+    if (not input.read(file_magic.data(), file_magic.size()) or
+        std::string_view{file_magic.data(), file_magic.size()} != magic or
+        not read(input, version) or version != format_version or
+        not read(input, index.templates_hash_) or
+        index.templates_hash_ != templates_hash) {
+        return std::nullopt;
+    }
+
+    std::uint32_t count{};
+    if (not read(input, count)) {
+        return std::nullopt;
+    }
+    for (std::uint32_t i = 0; i < count; i++) {
+        std::string path;
+        std::uint8_t flags{};
+        std::uint32_t permissions{};
+        std::vector<Placeholder> path_placeholders;
+        if (not read(input, path) or not read(input, flags) or
+            not read(input, permissions) or
+            not read(input, path_placeholders)) {
+            return std::nullopt;
+        }
+
+        TemplateEntry entry;
+        entry.path = path;
+        entry.is_directory = flags & directory_flag;
+        entry.permissions = static_cast<std::filesystem::perms>(permissions);
+        entry.path_placeholders = std::move(path_placeholders);
+        if (not entry.is_directory) {
+            entry.placeholders.emplace();
+            if (not read(input, entry.content_hash) or
+                (not(flags & verbatim_flag) and
+                 not read(input, *entry.placeholders))) {
+                return std::nullopt;
+            }
+        }
+        index.entries_.emplace(std::move(path), std::move(entry));
+    }
+
+    return index;
+}
+
+bool TemplateIndex::save(const std::filesystem::path& file) const {
+    // Write to a temporary file first so that a concurrent load() never sees
+    // a partially written index. Each process has its own since several of
+    // them can build the index at the same time
+    auto tmp_file = file;
+    tmp_file += "." + std::to_string(getpid()) + ".tmp";
+    {
+        std::ofstream output(tmp_file.native(),
+                             std::ios::binary | std::ios::trunc);
+        if (not output) {
+            return false;
+        }
+
+        output.write(magic.data(), magic.size());
+        write(output, format_version);
+        write(output, templates_hash_);
+        write(output, static_cast<std::uint32_t>(entries_.size()));
+        for (const auto& [path, entry] : entries_) {
+            const bool verbatim =
+                not entry.is_directory and entry.placeholders->empty();
+            std::uint8_t flags{};
+            if (entry.is_directory) {
+                flags |= directory_flag;
+            }
+            if (verbatim) {
+                flags |= verbatim_flag;
+            }
+
+            write(output, std::string_view{path});
+            write(output, flags);
+            write(output, static_cast<std::uint32_t>(entry.permissions));
+            write(output, *entry.path_placeholders);
+            if (not entry.is_directory) {
+                write(output, entry.content_hash);
+            }
+            if (not entry.is_directory and not verbatim) {
+                write(output, *entry.placeholders);
+            }
+        }
+
+        if (not output) {
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tmp_file, file, error);
+    return not error;
+}
+
+std::vector<TemplateEntry>
+TemplateIndex::entries(const std::filesystem::path& root) const {
+    const auto prefix = root.empty() ? std::string{}
+                                     : root.generic_string() + "/";
+
+    std::vector<TemplateEntry> entries;
+    for (auto it = entries_.lower_bound(prefix); it != end(entries_); ++it) {
+        const auto& [path, entry] = *it;
+        if (path.compare(0, prefix.size(), prefix) != 0) {
+            break;
+        }
+        auto& relative_entry = entries.emplace_back(entry);
+        relative_entry.path = path.substr(prefix.size());
+
+        // Make the path placeholders relative to the new path. Delimiters
+        // can't span over the prefix since it ends with a slash
+        const auto prefix_size = static_cast<std::uint32_t>(prefix.size());
+        auto& placeholders = *relative_entry.path_placeholders;
+        std::erase_if(placeholders, [prefix_size](const auto& placeholder) {
+            return placeholder.offset < prefix_size;
+        });
+        for (auto& placeholder : placeholders) {
+            placeholder.offset -= prefix_size;
+        }
+    }
+    return entries;
+}
+
+std::uint64_t TemplateIndex::hashFile(const std::filesystem::path& file) {
+    std::ifstream input(file.native(), std::ios::binary);
+    if (not input) {
+        return 0;
+    }
+
+    std::uint64_t hash{fnv_offset_basis};
+    std::array<char, 65536> buffer;
+    while (input.read(buffer.data(), buffer.size()) or input.gcount() > 0) {
+        hash = fnv1a(hash, {buffer.data(),
+                            static_cast<std::size_t>(input.gcount())});
+    }
+    return hash;
+}
+
+std::uint64_t TemplateIndex::hash(std::string_view content) {
+    return fnv1a(fnv_offset_basis, content);
+}
+
+std::uint64_t TemplateIndex::hashDirectory(const std::filesystem::path& root) {
+    namespace fs = std::filesystem;
+
+    std::error_code error;
+    fs::recursive_directory_iterator it{root, error};
+    if (error) {
+        return 0;
+    }
+
+    // The iteration order is unspecified so the records are sorted before
+    // being hashed. Symlinks are followed, as when the templates are read
+    std::vector<std::string> records;
+    for (; it != fs::recursive_directory_iterator{}; it.increment(error)) {
+        const auto status = it->status(error);
+        if (error) {
+            return 0;
+        }
+        auto& record = records.emplace_back(
+            it->path().lexically_relative(root).generic_string());
+        record += '\0';
+        record += std::to_string(static_cast<int>(status.type()));
+        record += ' ';
+        record += std::to_string(static_cast<unsigned>(status.permissions()));
+        if (fs::is_regular_file(status)) {
+            record += ' ';
+            record += std::to_string(it->file_size(error));
+            record += ' ';
+            record += std::to_string(
+                it->last_write_time(error).time_since_epoch().count());
+        }
+        if (error) {
+            return 0;
+        }
+    }
+    if (error) {
+        return 0;
+    }
+
+    std::sort(records.begin(), records.end());
+    auto hash = fnv_offset_basis;
+    for (const auto& record : records) {
+        hash = fnv1a(hash, record);
+        hash = fnv1a(hash, {"\n", 1});
+    }
+    return hash;
+}
+
+} // namespace cpgen
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "template_source.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cpgen {
+
+// Precomputed description of all the templates: the entries, their
+// permissions and the position of the potential placeholders in their path
+// and content. Files without any placeholder are marked as verbatim and the
+// content of each file is hashed to detect the templates that changed.
+// It is saved in a compact binary form along with a hash of the templates so
+// that it can be invalidated when the templates change, including when the
+// extracted templates are edited by hand
+class TemplateIndex {
+public:
+    // Increment each time the binary format changes
+    static constexpr std::uint32_t format_version = 2;
+
+    // Reads and scans all the templates provided by the source
+    static TemplateIndex build(const TemplateSource& source,
+                               std::uint64_t templates_hash);
+
+    // Returns std::nullopt if the file cannot be read, is invalid or if it
+    // was built for other templates or by another format version
+    static std::optional<TemplateIndex>
+    load(const std::filesystem::path& file, std::uint64_t templates_hash);
+
+    // Returns false if the file cannot be written
+    bool save(const std::filesystem::path& file) const;
+
+    // Same as TemplateSource::entries() but with the placeholders filled
+    std::vector<TemplateEntry> entries(const std::filesystem::path& root) const;
+
+    // 64 bits FNV-1a hash of a file content, 0 if it cannot be read
+    static std::uint64_t hashFile(const std::filesystem::path& file);
+
+    // Same hash for a content already in memory
+    static std::uint64_t hash(std::string_view content);
+
+    // Hash of the paths, types, sizes, permissions and modification times of
+    // all the entries below root, 0 if they cannot be listed. Cheaper than
+    // hashing the files content but still changes when one is added, removed
+    // or edited
+    static std::uint64_t hashDirectory(const std::filesystem::path& root);
+
+private:
+    std::uint64_t templates_hash_{};
+
+    // Generic paths relative to the templates root
+    std::map<std::string, TemplateEntry> entries_;
+};
+
+} // namespace cpgen
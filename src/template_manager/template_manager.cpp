@@ -6,7 +6,8 @@
 
 namespace cpgen {
 
-TemplateManager::TemplateManager() : impl_{std::make_unique<pImpl>()} {
+TemplateManager::TemplateManager(GenerationOptions options)
+    : impl_{std::make_unique<pImpl>(options)} {
 }
 
 TemplateManager::~TemplateManager() = default;
@@ -34,6 +35,21 @@ void TemplateManager::createTest(const ExecutableParameters& test,
     impl().createTest(test, project_root);
 }
 
+void TemplateManager::createBenchmark(const ExecutableParameters& benchmark,
+                                      std::filesystem::path project_root) {
+    impl().createBenchmark(benchmark, project_root);
+}
+
+std::vector<ComponentTiming>
+TemplateManager::createBatch(const BatchParameters& batch,
+                             std::filesystem::path project_root) {
+    return impl().createBatch(batch, project_root);
+}
+
+bool TemplateManager::upgrade(const std::filesystem::path& project_root) {
+    return impl().upgrade(project_root);
+}
+
 const TemplateManager::pImpl& TemplateManager::impl() const {
     return *impl_;
 }
@@ -1,27 +1,247 @@
 #include "template_manager_impl.h"
+#include "output_sink.h"
+#include "pattern_replacer.h"
+#include "project_marker.h"
+#include "sha256.h"
+#include "stream_buffer.h"
+#include "template_index.h"
+#include "template_source.h"
+#include "thread_pool.h"
+
+#include <cpgen/trace.h>
 
 #include <archive.h>
 #include <archive_entry.h>
 #include <curl/curl.h>
 #include <fmt/format.h>
 
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
 #include <cstdlib>
+#include <ctime>
+#include <deque>
+#include <fcntl.h>
 #include <fstream>
-#include <regex>
+#include <optional>
 #include <stdexcept>
 #include <stdio.h>
 #include <stdlib.h>
 #include <streambuf>
+#include <string_view>
+#include <sys/file.h>
+#include <thread>
 #include <unistd.h>
 #include <vector>
 
 namespace {
 
+// Identifies the version of a downloaded file so that it is only downloaded
+// again if it changed on the server
+struct Validators {
+    std::string etag;
+    curl_off_t filetime{-1};
+    std::string sha256;
+};
+
+std::filesystem::path validators_path(std::filesystem::path file) {
+    file += ".validators";
+    return file;
+}
+
+Validators read_validators(const std::filesystem::path& file) {
+    Validators validators;
+    std::ifstream input(validators_path(file).native());
+    std::string key;
+    while (input >> key) {
+        input >> std::ws;
+        if (key == "etag") {
+            std::getline(input, validators.etag);
+        } else if (key == "filetime") {
+            input >> validators.filetime;
+        } else if (key == "sha256") {
+            std::getline(input, validators.sha256);
+        } else {
+            std::string ignored;
+            std::getline(input, ignored);
+        }
+    }
+    return validators;
+}
+
+void write_validators(const std::filesystem::path& file,
+                      const Validators& validators) {
+    std::ofstream output(validators_path(file).native());
+    if (not validators.etag.empty()) {
+        output << "etag " << validators.etag << '\n';
+    }
+    if (validators.filetime >= 0) {
+        output << "filetime " << validators.filetime << '\n';
+    }
+    if (not validators.sha256.empty()) {
+        output << "sha256 " << validators.sha256 << '\n';
+    }
+}
+
 size_t write_data(void* ptr, size_t size, size_t nmemb, void* stream) {
     size_t written = fwrite(ptr, size, nmemb, (FILE*)stream);
     return written;
 }
 
+// Extracts the ETag of the last response (there can be several when
+// redirections are followed)
+size_t read_etag(char* buffer, size_t size, size_t nitems, void* etag_ptr) {
+    auto& etag = *static_cast<std::string*>(etag_ptr);
+    std::string_view header{buffer, size * nitems};
+
+    constexpr std::string_view etag_header{"etag:"};
+    if (header.starts_with("HTTP/")) {
+        etag.clear();
+    } else if (header.size() > etag_header.size() and
+               std::equal(begin(etag_header), end(etag_header), begin(header),
+                          [](char a, char b) {
+                              return a == std::tolower(
+                                              static_cast<unsigned char>(b));
+                          })) {
+        header.remove_prefix(etag_header.size());
+        const auto first = header.find_first_not_of(" \t");
+        const auto last = header.find_last_not_of(" \t\r\n");
+        if (first != std::string_view::npos) {
+            etag = header.substr(first, last - first + 1);
+        }
+    }
+    return size * nitems;
+}
+
+// Options shared by all the template transfers
+void set_transfer_options(CURL* curl, const std::string& url,
+                          std::string& etag) {
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1);
+    curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1);
+    curl_easy_setopt(curl, CURLOPT_FILETIME, 1);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, read_etag);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &etag);
+}
+
+// Only get the file if it differs from the current one. The returned headers
+// must be freed after the transfer
+struct curl_slist* set_conditions(CURL* curl, const Validators& current) {
+    struct curl_slist* headers{nullptr};
+    if (not current.etag.empty()) {
+        headers = curl_slist_append(
+            headers, fmt::format("If-None-Match: {}", current.etag).c_str());
+    }
+    if (current.filetime >= 0) {
+        curl_easy_setopt(curl, CURLOPT_TIMECONDITION, CURL_TIMECOND_IFMODSINCE);
+        curl_easy_setopt(curl, CURLOPT_TIMEVALUE_LARGE, current.filetime);
+    }
+    return headers;
+}
+
+// If-Range header restarting a resumed transfer from the beginning if the file
+// changed since it was interrupted, nullopt without a validator to check it.
+// Weak ETags can't be used with ranges
+std::optional<std::string> if_range_header(const Validators& partial) {
+    if (not partial.etag.empty() and not partial.etag.starts_with("W/")) {
+        return fmt::format("If-Range: {}", partial.etag);
+    }
+    if (partial.filetime >= 0) {
+        const auto time = static_cast<std::time_t>(partial.filetime);
+        std::tm date{};
+        gmtime_r(&time, &date);
+        std::array<char, 64> buffer{};
+        std::strftime(buffer.data(), buffer.size(),
+                      "%a, %d %b %Y %H:%M:%S GMT", &date);
+        return fmt::format("If-Range: {}", buffer.data());
+    }
+    return std::nullopt;
+}
+
+struct StreamWriter {
+    cpgen::StreamBuffer& buffer;
+    cpgen::Sha256& sha;
+};
+
+size_t stream_data(void* ptr, size_t size, size_t nmemb, void* writer_ptr) {
+    auto& writer = *static_cast<StreamWriter*>(writer_ptr);
+    writer.sha.update(ptr, size * nmemb);
+    // Returning less than what was received aborts the transfer
+    return writer.buffer.write(ptr, size * nmemb) ? size * nmemb : 0;
+}
+
+struct StreamReader {
+    cpgen::StreamBuffer& buffer;
+    std::vector<char> chunk;
+};
+
+la_ssize_t read_stream(struct archive*, void* reader_ptr, const void** data) {
+    auto& reader = *static_cast<StreamReader*>(reader_ptr);
+    *data = reader.chunk.data();
+    return static_cast<la_ssize_t>(
+        reader.buffer.read(reader.chunk.data(), reader.chunk.size()));
+}
+
+// Lock on a file, held until destruction. The templates are updated under an
+// exclusive lock and read under a shared one, so that an update never swaps
+// them while another process is generating files from them
+class FileLock {
+public:
+    enum class Mode { Exclusive, Shared };
+
+    explicit FileLock(const std::filesystem::path& file,
+                      Mode mode = Mode::Exclusive)
+        : fd_{open(file.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644)} {
+        if (fd_ < 0) {
+            throw std::runtime_error(
+                fmt::format("Failed to open {}", file.native()));
+        }
+        const auto operation = mode == Mode::Exclusive ? LOCK_EX : LOCK_SH;
+        if (flock(fd_, operation | LOCK_NB) != 0) {
+            fmt::print("{}\n", mode == Mode::Exclusive
+                                   ? "Waiting for the other cpgen processes "
+                                     "to finish using the templates"
+                                   : "Waiting for another cpgen process to "
+                                     "finish updating the templates");
+            flock(fd_, operation);
+        }
+    }
+
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+
+    ~FileLock() {
+        flock(fd_, LOCK_UN);
+        close(fd_);
+    }
+
+private:
+    int fd_;
+};
+
+// Where to extract an archive entry, nullopt if it is not part of the
+// templates
+std::optional<std::filesystem::path>
+staged_path(const std::filesystem::path& staging_root,
+            const std::filesystem::path& archive_path) {
+    if (archive_path.empty() or *archive_path.begin() != "templates") {
+        return std::nullopt;
+    }
+    const auto path = archive_path.lexically_relative("templates");
+    if (path.empty() or path == ".") {
+        return staging_root;
+    }
+    // Don't let an entry escape the staging directory
+    if (*path.begin() == "..") {
+        return std::nullopt;
+    }
+    return staging_root / path;
+}
+
 int copy_data(struct archive* ar, struct archive* aw) {
     int r;
     const void* buff;
@@ -38,6 +258,8 @@ int copy_data(struct archive* ar, struct archive* aw) {
             return (ARCHIVE_OK);
         }
         if (r != ARCHIVE_OK) {
+            fmt::print(stderr, "archive_read_data_block(): {}\n",
+                       archive_error_string(ar));
             return (r);
         }
         r = archive_write_data_block(aw, buff, size, offset);
@@ -49,35 +271,34 @@ int copy_data(struct archive* ar, struct archive* aw) {
     }
 }
 
-} // namespace
-
-namespace cpgen {
-
-TemplateManager::pImpl::pImpl() {
-    curl_global_init(CURL_GLOBAL_DEFAULT);
-    if (not std::filesystem::exists(templateRootPath())) {
-        update();
+// Headers given without delimiters are looked up in the include paths, as
+// with #include <header>
+std::string
+precompiled_headers_list(const std::vector<std::string>& headers) {
+    std::vector<std::string> list;
+    for (const auto& header : headers) {
+        if (header.empty()) {
+            continue;
+        }
+        if (header.front() == '"') {
+            list.push_back(header);
+        } else if (header.front() == '<') {
+            list.push_back(fmt::format("\"{}\"", header));
+        } else {
+            list.push_back(fmt::format("\"<{}>\"", header));
+        }
     }
+    return fmt::format("{}", fmt::join(list, " "));
 }
 
-TemplateManager::pImpl::~pImpl() {
-    curl_global_cleanup();
-}
-
-bool TemplateManager::pImpl::update() {
-    bool all_ok{true};
-    all_ok &= downloadTemplate();
-    all_ok &= extractTemplate();
-    return all_ok;
+std::filesystem::path
+project_destination(const cpgen::ProjectParameters& project) {
+    return std::filesystem::path{project.root_path} /
+           std::filesystem::path{project.name};
 }
 
-void TemplateManager::pImpl::createProject(const ProjectParameters& project) {
-    namespace fs = std::filesystem;
-    fs::path origin = templateRootPath() / fs::path{"project"};
-    fs::path destination = fs::path{project.root_path} / fs::path{project.name};
-    fs::copy(origin, destination,
-             fs::copy_options::recursive | fs::copy_options::skip_existing);
-
+std::map<std::string, std::string>
+project_dictionnary(const cpgen::ProjectParameters& project) {
     const auto conan_pkgs =
         fmt::format("\"{}\"", fmt::join(project.conan_pkgs, "\", \""));
 
@@ -92,41 +313,54 @@ void TemplateManager::pImpl::createProject(const ProjectParameters& project) {
         return s;
     }();
 
-    const auto dictionnary = std::map<std::string, std::string>{
+    return std::map<std::string, std::string>{
         {"project_name", project.name},
         {"project_description", project.description},
         {"project_version", project.version},
         {"conan_pkgs", conan_pkgs},
-        {"cmake_pkgs", cmake_pkgs}};
-
-    searchAndReplace(destination, std::move(dictionnary));
+        {"cmake_pkgs", cmake_pkgs},
+        {"project_pch", precompiled_headers_list(project.precompiled_headers)}};
 }
 
-void TemplateManager::pImpl::createLibrary(const LibraryParameters& library,
-                                           std::filesystem::path project_root) {
+std::filesystem::path library_template_root(cpgen::LibraryType type) {
     namespace fs = std::filesystem;
+    using cpgen::LibraryType;
+    switch (type) {
+    case LibraryType::HeaderOnly:
+        return fs::path{"library/header_only"};
+    case LibraryType::Module:
+        return fs::path{"library/module"};
+    case LibraryType::CxxModule:
+        return fs::path{"library/cxx_module"};
+    case LibraryType::Static:
+        [[fallthrough]];
+    case LibraryType::Shared:
+        return fs::path{"library/static_shared"};
+        break;
+    }
+    return fs::path(); // fix missing return warning
+}
 
-    const auto template_root = [this, &library]() {
-        switch (library.type) {
-        case LibraryType::HeaderOnly:
-            return templateRootPath() / "library/header_only";
-        case LibraryType::Module:
-            return templateRootPath() / "library/module";
-        case LibraryType::Static:
-            [[fallthrough]];
-        case LibraryType::Shared:
-            return templateRootPath() / "library/static_shared";
-            break;
-        }
-        return fs::path(); // fix missing return warning
-    }();
+// The test skeleton depends on the framework used to write the test cases
+std::filesystem::path test_template_root(const std::string& framework) {
+    namespace fs = std::filesystem;
+    if (framework == "catch2" or framework == "gtest") {
+        return fs::path{"test"} / framework;
+    }
+    return fs::path{"test/none"};
+}
 
-    const auto library_type_str = [](LibraryType type) -> std::string {
+std::map<std::string, std::string>
+library_dictionnary(const cpgen::LibraryParameters& library) {
+    const auto library_type_str = [](cpgen::LibraryType type) -> std::string {
+        using cpgen::LibraryType;
         switch (type) {
         case LibraryType::HeaderOnly:
             return "INTERFACE";
         case LibraryType::Module:
             return "MODULE";
+        case LibraryType::CxxModule:
+            [[fallthrough]];
         case LibraryType::Static:
             return "STATIC";
         case LibraryType::Shared:
@@ -138,94 +372,531 @@ void TemplateManager::pImpl::createLibrary(const LibraryParameters& library,
     const auto dependencies_list =
         fmt::format("{}", fmt::join(library.dependencies, "\n\t\t"));
 
-    const auto dictionnary = std::map<std::string, std::string>{
+    // Named modules need at least C++20
+    const auto standard = [&]() -> std::string {
+        const auto older = {"98", "03", "11", "14", "17"};
+        if (library.type == cpgen::LibraryType::CxxModule and
+            std::find(older.begin(), older.end(), library.standard) !=
+                older.end()) {
+            return "20";
+        }
+        return library.standard;
+    }();
+
+    // Module names are made of identifiers separated by dots, which become
+    // nested namespaces
+    auto module_name = library.name;
+    std::replace(module_name.begin(), module_name.end(), '-', '_');
+    std::string namespace_name;
+    for (const auto c : module_name) {
+        if (c == '.') {
+            namespace_name += "::";
+        } else {
+            namespace_name += c;
+        }
+    }
+
+    return std::map<std::string, std::string>{
         {"component_name", library.name},
-        {"component_std", library.standard},
+        {"component_module_name", module_name},
+        {"component_namespace", namespace_name},
+        {"component_std", standard},
         {"component_type", library_type_str(library.type)},
-        {"component_dependencies", dependencies_list}};
+        {"component_dependencies", dependencies_list},
+        {"component_unity", library.unity ? "ON" : "OFF"},
+        {"component_lto", library.lto ? "ON" : "OFF"},
+        {"component_pch",
+         precompiled_headers_list(library.precompiled_headers)}};
+}
+
+std::map<std::string, std::string>
+executable_dictionnary(const cpgen::ExecutableParameters& params) {
+    const auto dependencies_list =
+        fmt::format("{}", fmt::join(params.dependencies, "\n\t\t"));
+
+    return std::map<std::string, std::string>{
+        {"component_name", params.name},
+        {"component_std", params.standard},
+        {"component_dependencies", dependencies_list},
+        {"component_unity", params.unity ? "ON" : "OFF"},
+        {"component_lto", params.lto ? "ON" : "OFF"},
+        {"component_pgo_training", params.pgo_training ? "ON" : "OFF"},
+        {"component_test_framework", params.test_framework},
+        {"component_test_labels",
+         fmt::format("{}", fmt::join(params.test_labels, ";"))},
+        {"component_test_resources", params.test_resource_groups},
+        {"component_pch",
+         precompiled_headers_list(params.precompiled_headers)}};
+}
+
+// Values of the placeholders added to the templates after a component was
+// generated, so that they are not left as is when it is upgraded
+std::map<std::string, std::string>
+default_dictionnary(const std::filesystem::path& template_root) {
+    if (template_root == "project") {
+        return project_dictionnary({});
+    } else if (*template_root.begin() == "library") {
+        return library_dictionnary({});
+    }
+    return executable_dictionnary({});
+}
+
+// Each template file is read once and written once, directly to its final
+// location. Returns the hash of the written content
+std::uint64_t render_file(const cpgen::TemplateSource& source,
+                          const std::filesystem::path& template_root,
+                          const cpgen::TemplateEntry& entry,
+                          const cpgen::PatternReplacer& replacer,
+                          cpgen::OutputSink& sink,
+                          const std::filesystem::path& target) {
+    cpgen::TraceSpan span{"file", target.native()};
+
+    // Files without placeholders are copied without being read, when
+    // possible
+    if (replacer.isVerbatim(*entry.placeholders)) {
+        if (const auto file = source.file(template_root, entry)) {
+            sink.copyFile(*file, target, entry.permissions);
+            span.arg("copied", 1);
+            return entry.content_hash;
+        }
+    }
+
+    auto content = source.content(template_root, entry);
+    auto rendered = replacer.replace(content, *entry.placeholders);
+
+    span.arg("bytes_read", static_cast<std::int64_t>(content.size()));
+    span.arg("bytes_written",
+             static_cast<std::int64_t>(rendered ? rendered->size()
+                                                : content.size()));
+    span.arg("placeholders",
+             static_cast<std::int64_t>(entry.placeholders->size()));
+    span.arg("substituted", rendered.has_value());
+
+    const auto hash =
+        rendered ? cpgen::TemplateIndex::hash(*rendered) : entry.content_hash;
+    sink.writeFile(target,
+                   rendered ? std::move(*rendered) : std::move(content),
+                   entry.permissions);
+    return hash;
+}
+
+} // namespace
+
+namespace cpgen {
+
+// Nothing is done until the templates are actually needed so that commands
+// not generating anything stay cheap
+TemplateManager::pImpl::pImpl(GenerationOptions options) : options_{options} {
+}
+
+TemplateManager::pImpl::~pImpl() {
+    if (curl_initialized_) {
+        curl_global_cleanup();
+    }
+}
 
-    fs::copy(template_root, project_root,
-             fs::copy_options::recursive | fs::copy_options::skip_existing);
-    for (auto& entry : fs::directory_iterator(template_root)) {
-        searchAndReplace(project_root / entry.path().filename(), dictionnary);
+bool TemplateManager::pImpl::update() {
+    TraceSpan span{"update", "update"};
+
+    createConfigRoot();
+    std::optional<FileLock> lock;
+    {
+        TraceSpan lock_span{"update", "lock templates"};
+        lock.emplace(templateLockPath());
+    }
+    removeStaleTemplates();
+
+    // The archive is needed to render the templates from it so it can't be
+    // streamed in this case
+    const bool stream = options_.stream_update and not options_.from_archive;
+
+    auto status = DownloadStatus::Failed;
+    bool already_extracted{false};
+    if (stream) {
+        status = streamTemplate();
+        already_extracted = status == DownloadStatus::Downloaded;
+        if (status == DownloadStatus::Failed) {
+            fmt::print(stderr, "Failed to stream the templates, falling back "
+                               "to a regular download\n");
+        }
+    }
+    if (status == DownloadStatus::Failed) {
+        status = downloadTemplate();
+    }
+    if (status == DownloadStatus::Failed) {
+        return false;
+    }
+
+    // Nothing to do if the templates didn't change and are already available
+    const bool templates_available =
+        options_.from_archive or std::filesystem::exists(templateRootPath());
+    if (status == DownloadStatus::NotModified and templates_available) {
+        fmt::print("Templates are already up to date\n");
+        return true;
     }
+
+    bool all_ok{true};
+    if (not options_.from_archive and not already_extracted) {
+        all_ok &= extractTemplate();
+    }
+    template_source_.reset();
+    template_index_.reset();
+    template_entries_.clear();
+    if (all_ok) {
+        all_ok &= buildTemplateIndex();
+    }
+    return all_ok;
+}
+
+void TemplateManager::pImpl::createProject(const ProjectParameters& project) {
+    renderTemplate(fmt::format("project {}", project.name), "project",
+                   project_destination(project), project_dictionnary(project));
+}
+
+void TemplateManager::pImpl::createLibrary(const LibraryParameters& library,
+                                           std::filesystem::path project_root) {
+    renderTemplate(fmt::format("library {}", library.name),
+                   library_template_root(library.type), project_root,
+                   library_dictionnary(library));
 }
 
 void TemplateManager::pImpl::createExecutable(
     const ExecutableParameters& executable,
     std::filesystem::path project_root) {
-    createExecutableOrTest(executable, project_root,
-                           templateRootPath() / "executable");
+    renderTemplate(fmt::format("executable {}", executable.name), "executable",
+                   project_root, executable_dictionnary(executable));
 }
 
 void TemplateManager::pImpl::createTest(const ExecutableParameters& test,
                                         std::filesystem::path project_root) {
-    createExecutableOrTest(test, project_root, templateRootPath() / "test");
+    renderTemplate(fmt::format("test {}", test.name),
+                   test_template_root(test.test_framework), project_root,
+                   executable_dictionnary(test));
 }
 
-void TemplateManager::pImpl::createExecutableOrTest(
-    const ExecutableParameters& params, std::filesystem::path project_root,
-    std::filesystem::path template_root) {
-    namespace fs = std::filesystem;
+void TemplateManager::pImpl::createBenchmark(
+    const ExecutableParameters& benchmark, std::filesystem::path project_root) {
+    renderTemplate(fmt::format("benchmark {}", benchmark.name), "benchmark",
+                   project_root, executable_dictionnary(benchmark));
+}
 
-    const auto dependencies_list =
-        fmt::format("{}", fmt::join(params.dependencies, "\n\t\t"));
+std::vector<ComponentTiming>
+TemplateManager::pImpl::createBatch(const BatchParameters& batch,
+                                    std::filesystem::path project_root) {
+    // Everything is queued before waiting so that the components are rendered
+    // in parallel. A file planned by a previous component is skipped, as it
+    // would be if the components were created one after the other. Each
+    // template is looked up once, whatever its number of components
+    downloadMissingTemplates();
+    const FileLock lock{templateLockPath(), FileLock::Mode::Shared};
 
-    const auto dictionnary = std::map<std::string, std::string>{
-        {"component_name", params.name},
-        {"component_std", params.standard},
-        {"component_dependencies", dependencies_list}};
+    std::deque<PendingComponent> components;
+    std::set<std::filesystem::path> targets;
+
+    if (batch.project) {
+        const auto& project = *batch.project;
+        auto& component = components.emplace_back(
+            fmt::format("project {}", project.name), "project",
+            project_dictionnary(project), options_.engine);
+        queueComponent(component, project_destination(project), targets);
+    }
+
+    for (const auto& library : batch.libraries) {
+        auto& component = components.emplace_back(
+            fmt::format("library {}", library.name),
+            library_template_root(library.type), library_dictionnary(library),
+            options_.engine);
+        queueComponent(component, project_root, targets);
+    }
+
+    for (const auto& executable : batch.executables) {
+        auto& component = components.emplace_back(
+            fmt::format("executable {}", executable.name), "executable",
+            executable_dictionnary(executable), options_.engine);
+        queueComponent(component, project_root, targets);
+    }
 
-    fs::copy(template_root, project_root,
-             fs::copy_options::recursive | fs::copy_options::skip_existing);
-    for (auto& entry : fs::directory_iterator(template_root)) {
-        searchAndReplace(project_root / entry.path().filename(), dictionnary);
+    for (const auto& test : batch.tests) {
+        auto& component = components.emplace_back(
+            fmt::format("test {}", test.name),
+            test_template_root(test.test_framework),
+            executable_dictionnary(test), options_.engine);
+        queueComponent(component, project_root, targets);
     }
+
+    for (const auto& benchmark : batch.benchmarks) {
+        auto& component = components.emplace_back(
+            fmt::format("benchmark {}", benchmark.name), "benchmark",
+            executable_dictionnary(benchmark), options_.engine);
+        queueComponent(component, project_root, targets);
+    }
+
+    {
+        TraceSpan span{"generation", "render components"};
+        threadPool().wait();
+    }
+    finishGeneration();
+    recordGeneration(components);
+
+    std::vector<ComponentTiming> timings;
+    timings.reserve(components.size());
+    for (const auto& component : components) {
+        timings.push_back(ComponentTiming{
+            component.name, component.files,
+            std::chrono::nanoseconds{component.render_time_ns}});
+    }
+    return timings;
 }
 
-bool TemplateManager::pImpl::downloadTemplate() {
-    const auto filename = templateArchivePath().native();
+TemplateManager::pImpl::DownloadStatus
+TemplateManager::pImpl::downloadTemplate() {
+    namespace fs = std::filesystem;
+    TraceSpan span{"update", "download templates"};
+
+    initCurl();
+    createConfigRoot();
+    const auto archive = templateArchivePath();
+    auto partial = archive;
+    partial += ".part";
     const auto url = templateUrl();
 
+    const auto current = fs::exists(archive) ? read_validators(archive)
+                                             : Validators{};
+    const auto partial_validators = read_validators(partial);
+
+    // Resume the previous download if it was interrupted, as long as the
+    // server can tell whether the file changed in the meantime
+    const auto if_range = if_range_header(partial_validators);
+    std::error_code error;
+    curl_off_t resume_from{0};
+    if (if_range and fs::exists(partial)) {
+        const auto size = fs::file_size(partial, error);
+        resume_from = error ? 0 : static_cast<curl_off_t>(size);
+    }
+
     auto curl = curl_easy_init();
-    if (curl) {
-        auto fp = fopen(filename.c_str(), "wb");
+    if (not curl) {
+        fmt::print(stderr, "Failed to setup libcurl\n");
+        return DownloadStatus::Failed;
+    }
+
+    for (;;) {
+        const bool resume = resume_from > 0;
+        auto fp = fopen(partial.c_str(), resume ? "ab" : "wb");
         if (fp == nullptr) {
-            fmt::print(stderr, "Failed to open {} for writing\n", filename);
+            fmt::print(stderr, "Failed to open {} for writing\n",
+                       partial.native());
             curl_easy_cleanup(curl);
-            return false;
+            return DownloadStatus::Failed;
         }
 
-        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0);
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0);
-        curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1);
+        std::string etag;
+        struct curl_slist* headers{nullptr};
 
+        set_transfer_options(curl, url, etag);
         curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_data);
         curl_easy_setopt(curl, CURLOPT_WRITEDATA, fp);
 
-        auto res = curl_easy_perform(curl);
+        if (resume) {
+            curl_easy_setopt(curl, CURLOPT_RESUME_FROM_LARGE, resume_from);
+            // Get the whole file again if it changed since the interruption
+            headers = curl_slist_append(headers, if_range->c_str());
+        } else {
+            headers = set_conditions(curl, current);
+        }
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+
+        const auto res = curl_easy_perform(curl);
+        fclose(fp);
+        curl_slist_free_all(headers);
+
+        long response_code{};
+        long condition_unmet{};
+        curl_off_t filetime{-1};
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
+        curl_easy_getinfo(curl, CURLINFO_CONDITION_UNMET, &condition_unmet);
+        curl_easy_getinfo(curl, CURLINFO_FILETIME_T, &filetime);
+        if (span.enabled()) {
+            curl_off_t downloaded{};
+            curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &downloaded);
+            span.arg("bytes_downloaded", downloaded);
+            span.arg("response_code", response_code);
+        }
+        curl_easy_reset(curl);
+
+        // The server can't resume the transfer, start over
+        if (resume and (res == CURLE_RANGE_ERROR or response_code == 416)) {
+            resume_from = 0;
+            continue;
+        }
+
         if (res != CURLE_OK) {
             fmt::print(stderr, "curl_easy_perform() failed: {}\n",
                        curl_easy_strerror(res));
+            // Keep what was received to resume the download next time
+            write_validators(partial, Validators{etag, filetime, {}});
             curl_easy_cleanup(curl);
-            return false;
+            return DownloadStatus::Failed;
         }
 
         curl_easy_cleanup(curl);
-        fclose(fp);
 
-        return true;
-    } else {
+        if (response_code == 304 or condition_unmet) {
+            fs::remove(partial, error);
+            return DownloadStatus::NotModified;
+        }
+
+        const auto validators =
+            Validators{etag, filetime, Sha256::hashFile(partial)};
+        fs::remove(validators_path(partial), error);
+
+        // The server may not support conditional requests, in which case the
+        // content is compared to what we already have
+        if (fs::exists(archive) and validators.sha256 == current.sha256) {
+            fs::remove(partial, error);
+            write_validators(archive, validators);
+            return DownloadStatus::NotModified;
+        }
+
+        fs::rename(partial, archive);
+        write_validators(archive, validators);
+        return DownloadStatus::Downloaded;
+    }
+}
+
+TemplateManager::pImpl::DownloadStatus
+TemplateManager::pImpl::streamTemplate() {
+    namespace fs = std::filesystem;
+    TraceSpan span{"update", "stream templates"};
+
+    initCurl();
+    createConfigRoot();
+    const auto url = templateUrl();
+
+    // There is no archive to attach the validators to so use the extracted
+    // templates instead
+    const auto current = fs::exists(templateRootPath())
+                             ? read_validators(templateRootPath())
+                             : Validators{};
+
+    auto curl = curl_easy_init();
+    if (not curl) {
         fmt::print(stderr, "Failed to setup libcurl\n");
-        return false;
+        return DownloadStatus::Failed;
+    }
+
+    StreamBuffer buffer{stream_buffer_size};
+    Sha256 sha;
+    StreamWriter writer{buffer, sha};
+    std::string etag;
+
+    set_transfer_options(curl, url, etag);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, stream_data);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &writer);
+    auto headers = set_conditions(curl, current);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+
+    // The transfer runs on its own thread while the data is decompressed and
+    // extracted on this one, as soon as it arrives
+    CURLcode res{CURLE_OK};
+    std::thread transfer{[&] {
+        res = curl_easy_perform(curl);
+        buffer.close();
+    }};
+
+    bool extracted{false};
+    if (buffer.waitForData()) {
+        StreamReader reader{buffer, std::vector<char>(stream_chunk_size)};
+
+        auto a = archive_read_new();
+        archive_read_support_format_tar(a);
+        archive_read_support_filter_gzip(a);
+        if (archive_read_open(a, &reader, nullptr, read_stream, nullptr)) {
+            fmt::print(stderr, "archive_read_open(): {}\n",
+                       archive_error_string(a));
+        } else {
+            extracted = extractArchive(a);
+        }
+        archive_read_free(a);
+
+        // libarchive can stop before the end of the stream (e.g tar padding)
+        // so consume the rest to let the transfer complete
+        if (extracted) {
+            while (buffer.read(reader.chunk.data(), reader.chunk.size()) > 0) {
+            }
+        }
+    }
+    // Unblocks the transfer if the extraction stopped early
+    buffer.close();
+    transfer.join();
+
+    long response_code{};
+    long condition_unmet{};
+    curl_off_t filetime{-1};
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
+    curl_easy_getinfo(curl, CURLINFO_CONDITION_UNMET, &condition_unmet);
+    curl_easy_getinfo(curl, CURLINFO_FILETIME_T, &filetime);
+    if (span.enabled()) {
+        curl_off_t downloaded{};
+        curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &downloaded);
+        span.arg("bytes_downloaded", downloaded);
+        span.arg("response_code", response_code);
+    }
+    curl_easy_cleanup(curl);
+    curl_slist_free_all(headers);
+
+    // The extracted templates only replace the current ones once the whole
+    // archive was received and read
+    if (res != CURLE_OK) {
+        fmt::print(stderr, "curl_easy_perform() failed: {}\n",
+                   curl_easy_strerror(res));
+        std::filesystem::remove_all(stagingRootPath());
+        return DownloadStatus::Failed;
+    }
+
+    if (response_code == 304 or condition_unmet) {
+        std::filesystem::remove_all(stagingRootPath());
+        return DownloadStatus::NotModified;
     }
+
+    if (not extracted or not installStagedTemplates()) {
+        return DownloadStatus::Failed;
+    }
+
+    write_validators(templateRootPath(),
+                     Validators{etag, filetime, sha.hexDigest()});
+    return DownloadStatus::Downloaded;
 }
 
 bool TemplateManager::pImpl::extractTemplate() {
     const auto filename = templateArchivePath().native();
 
-    struct archive* a;
+    auto a = archive_read_new();
+    archive_read_support_format_tar(a);
+    archive_read_support_filter_gzip(a);
+
+    if (archive_read_open_filename(a, filename.c_str(), 10240)) {
+        fmt::print(stderr, "archive_read_open_filename(): {}\n",
+                   archive_error_string(a));
+        archive_read_free(a);
+        return false;
+    }
+
+    const bool extracted = extractArchive(a);
+    archive_read_free(a);
+    return extracted and installStagedTemplates();
+}
+
+bool TemplateManager::pImpl::extractArchive(struct archive* a) {
+    namespace fs = std::filesystem;
+    TraceSpan span{"update", "extract templates"};
+    std::int64_t extracted_entries{0};
+    std::int64_t extracted_bytes{0};
+
+    const auto staging_root = stagingRootPath();
+    fs::remove_all(staging_root);
+    fs::create_directories(staging_root);
+
     struct archive* ext;
     struct archive_entry* entry;
     int r;
@@ -234,18 +905,18 @@ bool TemplateManager::pImpl::extractTemplate() {
     flags |= ARCHIVE_EXTRACT_PERM;
     flags |= ARCHIVE_EXTRACT_ACL;
     flags |= ARCHIVE_EXTRACT_FFLAGS;
+    flags |= ARCHIVE_EXTRACT_SECURE_SYMLINKS;
+    flags |= ARCHIVE_EXTRACT_SECURE_NODOTDOT;
 
-    a = archive_read_new();
     ext = archive_write_disk_new();
     archive_write_disk_set_options(ext, flags);
-    archive_read_support_format_tar(a);
-    archive_read_support_filter_gzip(a);
 
-    if ((r = archive_read_open_filename(a, filename.c_str(), 10240))) {
-        fmt::print(stderr, "archive_read_open_filename(): {}\n",
-                   archive_error_string(a));
+    const auto abort_extraction = [&] {
+        archive_write_free(ext);
+        fs::remove_all(staging_root);
         return false;
-    }
+    };
+
     for (;;) {
         r = archive_read_next_header(a, &entry);
         if (r == ARCHIVE_EOF) {
@@ -254,93 +925,464 @@ bool TemplateManager::pImpl::extractTemplate() {
         if (r != ARCHIVE_OK) {
             fmt::print(stderr, "archive_read_next_header(): {}\n",
                        archive_error_string(a));
-            return false;
+            return abort_extraction();
+        }
+
+        const auto path =
+            staged_path(staging_root, archive_entry_pathname(entry));
+        if (not path) {
+            continue;
         }
+        archive_entry_set_pathname(entry, path->c_str());
+        if (const char* link = archive_entry_hardlink(entry)) {
+            const auto link_path = staged_path(staging_root, link);
+            if (not link_path) {
+                continue;
+            }
+            archive_entry_set_hardlink(entry, link_path->c_str());
+        }
+
         r = archive_write_header(ext, entry);
         if (r != ARCHIVE_OK) {
             fmt::print(stderr, "archive_write_header(): {}\n",
                        archive_error_string(ext));
-            return false;
+            return abort_extraction();
         } else {
-            copy_data(a, ext);
+            // A truncated entry would otherwise be silently installed
+            if (copy_data(a, ext) != ARCHIVE_OK) {
+                return abort_extraction();
+            }
+            ++extracted_entries;
+            extracted_bytes += archive_entry_size(entry);
             r = archive_write_finish_entry(ext);
             if (r != ARCHIVE_OK) {
                 fmt::print(stderr, "archive_write_finish_entry(): {}\n",
                            archive_error_string(ext));
-                return false;
+                return abort_extraction();
             }
         }
     }
     archive_read_close(a);
-    archive_read_free(a);
 
     archive_write_close(ext);
     archive_write_free(ext);
 
+    span.arg("entries", extracted_entries);
+    span.arg("bytes", extracted_bytes);
+
+    return true;
+}
+
+bool TemplateManager::pImpl::installStagedTemplates() {
     namespace fs = std::filesystem;
-    fs::remove_all(templateRootPath());
-    fs::rename(fs::current_path() / "templates", templateRootPath());
+    const auto staging_root = stagingRootPath();
+
+    // Move the current templates out of the way first since a directory can't
+    // be replaced by a rename if it isn't empty. Both renames stay on the same
+    // filesystem so the templates are only missing for a very short time
+    const auto old_root =
+        configRootPath() / fmt::format("templates.old.{}", getpid());
+    std::error_code error;
+    if (fs::exists(templateRootPath())) {
+        fs::rename(templateRootPath(), old_root, error);
+        if (error) {
+            fmt::print(stderr, "Failed to move {}: {}\n",
+                       templateRootPath().native(), error.message());
+            fs::remove_all(staging_root);
+            return false;
+        }
+    }
+    fs::rename(staging_root, templateRootPath(), error);
+    if (error) {
+        fmt::print(stderr, "Failed to move {}: {}\n", staging_root.native(),
+                   error.message());
+        fs::rename(old_root, templateRootPath(), error);
+        fs::remove_all(staging_root);
+        return false;
+    }
+    fs::remove_all(old_root, error);
 
     return true;
 }
 
-void TemplateManager::pImpl::searchAndReplace(
-    std::filesystem::path root,
-    std::map<std::string, std::string> dictionnary) const {
+void TemplateManager::pImpl::renderTemplate(
+    std::string name, const std::filesystem::path& template_root,
+    const std::filesystem::path& destination,
+    std::map<std::string, std::string> dictionnary) {
+    downloadMissingTemplates();
+    const FileLock lock{templateLockPath(), FileLock::Mode::Shared};
+
+    std::deque<PendingComponent> components;
+    auto& component =
+        components.emplace_back(std::move(name), template_root,
+                                std::move(dictionnary), options_.engine);
+    std::set<std::filesystem::path> targets;
+    queueComponent(component, destination, targets);
+    threadPool().wait();
+    finishGeneration();
+    recordGeneration(components);
+}
+
+void TemplateManager::pImpl::queueComponent(
+    PendingComponent& component, const std::filesystem::path& destination,
+    std::set<std::filesystem::path>& targets) {
     namespace fs = std::filesystem;
+    using clock = std::chrono::steady_clock;
 
-    auto contain_pattern = [](const std::string& input) {
-        std::regex r("__.*__");
-        return std::regex_search(input, r);
-    };
+    const auto& source = templateSource();
+    const auto& entries = templateEntries(component.template_root);
+    auto& pool = threadPool();
+    auto& sink = outputSink();
 
-    auto replace_patterns = [&dictionnary](const std::string& input) {
-        std::string output = input;
-        for (const auto& [from, to] : dictionnary) {
-            std::regex r(fmt::format("__{}__", from));
-            output = std::regex_replace(output, r, to);
+    TraceSpan span{"component", component.name};
+    component.destination = destination;
+
+    // Entries are sorted so that directories are created before their content
+    // is rendered. Each file has its own destination path so the resulting
+    // tree doesn't depend on the scheduling. The index gives the placeholders
+    // locations so neither the paths nor the files have to be scanned.
+    // Existing files are left untouched, like with
+    // fs::copy_options::skip_existing
+    sink.createDirectories(destination);
+    for (const auto& entry : entries) {
+        auto path = entry.path.native();
+        if (auto new_path =
+                component.replacer.replace(path, *entry.path_placeholders)) {
+            path = std::move(*new_path);
         }
-        return output;
-    };
+        auto target = destination / path;
+        if (entry.is_directory) {
+            sink.createDirectories(target);
+        } else if (targets.insert(target).second) {
+            pool.submit([&source, &component, &entry, &sink,
+                         target = std::move(target)] {
+                const auto start = clock::now();
+                if (not sink.exists(target)) {
+                    const auto hash =
+                        render_file(source, component.template_root, entry,
+                                    component.replacer, sink, target);
+                    ++component.files;
+
+                    std::scoped_lock lock{component.generated_mutex};
+                    component.generated.emplace_back(
+                        target, ProjectMarker::GeneratedFile{
+                                    component.name,
+                                    entry.path.generic_string(),
+                                    entry.content_hash, hash});
+                }
+                component.render_time_ns +=
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        clock::now() - start)
+                        .count();
+            });
+        }
+    }
+}
+
+void TemplateManager::pImpl::finishGeneration() {
+    auto& sink = outputSink();
+    {
+        TraceSpan span{"generation", "flush output"};
+        if (not sink.flush()) {
+            fmt::print(stderr, "Some files could not be written\n");
+        }
+    }
+
+    if (options_.dry_run or options_.output == OutputSinkType::Memory) {
+        auto& memory = static_cast<MemorySink&>(sink);
+        if (options_.dry_run) {
+            fmt::print("Dry run, the following would be generated:\n");
+            for (const auto& [path, entry] : memory.entries()) {
+                if (entry.is_directory) {
+                    fmt::print("  {}/\n", path);
+                } else {
+                    std::error_code error;
+                    const auto size =
+                        entry.source.empty()
+                            ? entry.content.size()
+                            : std::filesystem::file_size(entry.source, error);
+                    fmt::print("  {} ({} bytes)\n", path, error ? 0 : size);
+                }
+            }
+        }
+        memory.clear();
+    }
+}
+
+void TemplateManager::pImpl::recordGeneration(
+    const std::deque<PendingComponent>& components) {
+    namespace fs = std::filesystem;
+    if (options_.dry_run or options_.output == OutputSinkType::Memory) {
+        return;
+    }
+
+    TraceSpan span{"generation", "record generation"};
+    std::map<fs::path, std::vector<const PendingComponent*>> projects;
+    for (const auto& component : components) {
+        projects[component.destination].push_back(&component);
+    }
+
+    for (const auto& [root, project_components] : projects) {
+        // Nothing is recorded outside of a cpgen project
+        const auto marker_file = ProjectMarker::path(root);
+        if (not fs::exists(marker_file)) {
+            continue;
+        }
+        auto marker = ProjectMarker::load(marker_file);
+        if (not marker) {
+            fmt::print(stderr, "Invalid project marker {}, the generated "
+                               "files are not recorded\n",
+                       marker_file.native());
+            continue;
+        }
+
+        for (const auto* component : project_components) {
+            marker->components[component->name] = ProjectMarker::Component{
+                component->template_root.generic_string(),
+                component->dictionnary};
+            for (const auto& [target, generated] : component->generated) {
+                // The marker itself is replaced by the records
+                if (target != marker_file) {
+                    marker->files[target.lexically_relative(root)
+                                      .generic_string()] = generated;
+                }
+            }
+        }
+        if (not marker->save(marker_file)) {
+            fmt::print(stderr, "Failed to save the project marker {}\n",
+                       marker_file.native());
+        }
+    }
+}
+
+bool TemplateManager::pImpl::upgrade(
+    const std::filesystem::path& project_root) {
+    namespace fs = std::filesystem;
+    TraceSpan span{"upgrade", "upgrade"};
+
+    const auto marker_file = ProjectMarker::path(project_root);
+    auto marker = ProjectMarker::load(marker_file);
+    if (not marker) {
+        fmt::print(stderr, "Failed to read the project marker {}\n",
+                   marker_file.native());
+        return false;
+    }
+
+    downloadMissingTemplates();
+    const FileLock lock{templateLockPath(), FileLock::Mode::Shared};
+
+    const auto& source = templateSource();
+    auto& sink = outputSink();
+    const bool write_files =
+        not options_.dry_run and options_.output != OutputSinkType::Memory;
+
+    // Only the files whose template changed are looked at, the others are
+    // known to be up to date from their recorded template hash
+    std::vector<std::string> updated;
+    std::vector<std::string> added;
+    std::vector<std::string> modified;
+    std::set<std::string> current_files;
+    for (const auto& [name, component] : marker->components) {
+        auto dictionnary = default_dictionnary(component.template_root);
+        for (const auto& [key, value] : component.dictionnary) {
+            dictionnary[key] = value;
+        }
+        const PatternReplacer replacer{dictionnary, options_.engine};
+        for (const auto& entry : templateEntries(component.template_root)) {
+            if (entry.is_directory) {
+                continue;
+            }
+            auto path = entry.path.native();
+            if (auto new_path =
+                    replacer.replace(path, *entry.path_placeholders)) {
+                path = std::move(*new_path);
+            }
+            const auto target = project_root / path;
+            auto relative = fs::path{path}.generic_string();
+            current_files.insert(relative);
+            if (target == marker_file) {
+                continue;
+            }
 
-    std::function<void(std::filesystem::path)> search_and_replace =
-        [&](std::filesystem::path root) {
-            for (auto& entry : fs::directory_iterator(root)) {
-                const auto path = entry.path();
-                const auto directory = entry.path().parent_path();
-                auto filename = path.filename().native();
-                if (contain_pattern(filename)) {
-                    filename = replace_patterns(filename);
-                    fs::rename(path, directory / filename);
+            const auto generated = marker->files.find(relative);
+            const bool recorded = generated != marker->files.end();
+            if (recorded) {
+                if (generated->second.template_hash == entry.content_hash) {
+                    continue;
+                }
+                // Changes made since the generation are never overwritten
+                if (TemplateIndex::hashFile(target) !=
+                    generated->second.content_hash) {
+                    modified.push_back(std::move(relative));
+                    continue;
                 }
-                const auto filepath = directory / filename;
-                if (entry.is_regular_file()) {
-                    std::ifstream input(filepath.native());
-                    std::string content;
-                    input.seekg(0, std::ios::end);
-                    const auto size = input.tellg();
-                    if (size > 0) {
-                        content.reserve();
-                        input.seekg(0, std::ios::beg);
-
-                        content.assign((std::istreambuf_iterator<char>(input)),
-                                       std::istreambuf_iterator<char>());
-                        if (contain_pattern(content)) {
-                            content = replace_patterns(content);
-                            std::ofstream output(filepath.native());
-                            output << content;
-                        }
-                    }
-                } else if (entry.is_directory()) {
-                    search_and_replace(filepath);
+                if (write_files) {
+                    std::error_code error;
+                    fs::remove(target, error);
                 }
+            } else if (sink.exists(target)) {
+                // Not generated by cpgen
+                continue;
             }
-        };
 
-    search_and_replace(root);
+            sink.createDirectories(target.parent_path());
+            const auto hash = render_file(source, component.template_root,
+                                          entry, replacer, sink, target);
+            marker->files[relative] = ProjectMarker::GeneratedFile{
+                name, entry.path.generic_string(), entry.content_hash, hash};
+            (recorded ? updated : added).push_back(std::move(relative));
+        }
+    }
+
+    // Files whose template was removed are left in place but not tracked
+    // anymore
+    std::vector<std::string> obsolete;
+    std::erase_if(marker->files, [&](const auto& generated) {
+        if (current_files.contains(generated.first)) {
+            return false;
+        }
+        obsolete.push_back(generated.first);
+        return true;
+    });
+
+    finishGeneration();
+    if (write_files and not marker->save(marker_file)) {
+        fmt::print(stderr, "Failed to save the project marker {}\n",
+                   marker_file.native());
+        return false;
+    }
+
+    fmt::print("{} updated, {} added, {} modified, {} obsolete\n",
+               updated.size(), added.size(), modified.size(), obsolete.size());
+    for (const auto& path : updated) {
+        fmt::print("  updated   {}\n", path);
+    }
+    for (const auto& path : added) {
+        fmt::print("  added     {}\n", path);
+    }
+    for (const auto& path : modified) {
+        fmt::print("  modified  {} (kept, its template changed)\n", path);
+    }
+    for (const auto& path : obsolete) {
+        fmt::print("  obsolete  {} (kept, no longer in the templates)\n",
+                   path);
+    }
+
+    span.arg("updated", static_cast<std::int64_t>(updated.size()));
+    span.arg("added", static_cast<std::int64_t>(added.size()));
+    span.arg("modified", static_cast<std::int64_t>(modified.size()));
+    return true;
+}
+
+const std::vector<TemplateEntry>& TemplateManager::pImpl::templateEntries(
+    const std::filesystem::path& template_root) {
+    auto entries = template_entries_.find(template_root);
+    if (entries == template_entries_.end()) {
+        entries =
+            template_entries_
+                .emplace(template_root, templateIndex().entries(template_root))
+                .first;
+    }
+    return entries->second;
+}
+
+void TemplateManager::pImpl::downloadMissingTemplates() {
+    // Download the templates the first time they are needed
+    const auto templates = options_.from_archive ? templateArchivePath()
+                                                 : templateRootPath();
+    if (not std::filesystem::exists(templates)) {
+        update();
+    }
+}
+
+const TemplateSource& TemplateManager::pImpl::templateSource() {
+    if (not template_source_) {
+        TraceSpan span{"templates", "load templates"};
+        if (options_.from_archive) {
+            template_source_ =
+                std::make_unique<ArchiveTemplateSource>(templateArchivePath());
+        } else {
+            template_source_ =
+                std::make_unique<DirectoryTemplateSource>(templateRootPath());
+        }
+    }
+    return *template_source_;
+}
+
+const TemplateIndex& TemplateManager::pImpl::templateIndex() {
+    if (not template_index_) {
+        TraceSpan span{"templates", "load index"};
+        const auto templates_hash = templatesHash();
+        if (auto index =
+                TemplateIndex::load(templateIndexPath(), templates_hash)) {
+            template_index_ =
+                std::make_unique<TemplateIndex>(std::move(*index));
+        } else {
+            buildTemplateIndex();
+        }
+    }
+    return *template_index_;
+}
+
+std::uint64_t TemplateManager::pImpl::templatesHash() const {
+    // The extracted templates can be edited by hand, unlike the archive
+    if (options_.from_archive) {
+        return TemplateIndex::hashFile(templateArchivePath());
+    }
+    return TemplateIndex::hashDirectory(templateRootPath());
+}
+
+bool TemplateManager::pImpl::buildTemplateIndex() {
+    TraceSpan span{"templates", "build index"};
+    template_index_ = std::make_unique<TemplateIndex>(TemplateIndex::build(
+        templateSource(), templatesHash()));
+    if (not template_index_->save(templateIndexPath())) {
+        fmt::print(stderr, "Failed to save the template index to {}\n",
+                   templateIndexPath().native());
+        return false;
+    }
+    return true;
+}
+
+ThreadPool& TemplateManager::pImpl::threadPool() {
+    if (not thread_pool_) {
+        thread_pool_ = std::make_unique<ThreadPool>(options_.jobs);
+    }
+    return *thread_pool_;
+}
+
+OutputSink& TemplateManager::pImpl::outputSink() {
+    if (not output_sink_) {
+        if (options_.dry_run) {
+            output_sink_ = std::make_unique<MemorySink>();
+        } else {
+            switch (options_.output) {
+            case OutputSinkType::Filesystem:
+                output_sink_ = std::make_unique<FilesystemSink>();
+                break;
+            case OutputSinkType::Batched:
+                output_sink_ = std::make_unique<BatchedSink>();
+                break;
+            case OutputSinkType::Memory:
+                output_sink_ = std::make_unique<MemorySink>();
+                break;
+            }
+        }
+    }
+    return *output_sink_;
+}
+
+void TemplateManager::pImpl::initCurl() {
+    if (not curl_initialized_) {
+        curl_global_init(CURL_GLOBAL_DEFAULT);
+        curl_initialized_ = true;
+    }
 }
 
 std::string TemplateManager::pImpl::templateUrl() const {
+    if (not options_.templates_url.empty()) {
+        return options_.templates_url;
+    }
     return "https://github.com/BenjaminNavarro/cpgen/raw/master/share/"
            "templates.tar.gz";
 }
@@ -349,18 +1391,53 @@ std::filesystem::path TemplateManager::pImpl::templateArchivePath() const {
     return configRootPath() / "templates.tar.gz";
 }
 
+std::filesystem::path TemplateManager::pImpl::templateIndexPath() const {
+    return configRootPath() / "templates.index";
+}
+
+std::filesystem::path TemplateManager::pImpl::templateLockPath() const {
+    return configRootPath() / "templates.lock";
+}
+
 std::filesystem::path TemplateManager::pImpl::templateRootPath() const {
     return configRootPath() / "templates";
 }
 
-std::filesystem::path TemplateManager::pImpl::configRootPath() const {
-    if (const char* home_path = std::getenv("HOME")) {
-        auto path = std::filesystem::absolute(std::filesystem::path(home_path) /
-                                              ".cpgen");
-        std::filesystem::create_directories(path);
-        return path;
-    } else {
-        throw std::runtime_error("Failed to get HOME environment variable");
+std::filesystem::path TemplateManager::pImpl::stagingRootPath() const {
+    // Next to the current templates so that they end up on the same
+    // filesystem and can be swapped with a rename. The path is canonical since
+    // ARCHIVE_EXTRACT_SECURE_SYMLINKS rejects any symlink in it, e.g in $HOME
+    return std::filesystem::canonical(configRootPath()) /
+           fmt::format("templates.staging.{}", getpid());
+}
+
+const std::filesystem::path& TemplateManager::pImpl::configRootPath() const {
+    if (config_root_.empty()) {
+        if (const char* home_path = std::getenv("HOME")) {
+            config_root_ = std::filesystem::absolute(
+                std::filesystem::path(home_path) / ".cpgen");
+        } else {
+            throw std::runtime_error("Failed to get HOME environment variable");
+        }
+    }
+    return config_root_;
+}
+
+void TemplateManager::pImpl::createConfigRoot() const {
+    std::filesystem::create_directories(configRootPath());
+}
+
+void TemplateManager::pImpl::removeStaleTemplates() const {
+    // Leftovers from interrupted updates. Only called while holding the lock
+    // so no other process can be using them
+    for (const auto& entry :
+         std::filesystem::directory_iterator(configRootPath())) {
+        const auto name = entry.path().filename().native();
+        if (name.starts_with("templates.staging.") or
+            name.starts_with("templates.old.")) {
+            std::error_code error;
+            std::filesystem::remove_all(entry.path(), error);
+        }
     }
 }
 
@@ -1,13 +1,31 @@
+#include "pattern_replacer.h"
+#include "project_marker.h"
+#include "template_source.h"
 #include <cpgen/template_manager.h>
 
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct archive;
 
 namespace cpgen {
 
+class OutputSink;
+class TemplateIndex;
+class ThreadPool;
+
 class TemplateManager::pImpl {
 public:
-    pImpl();
+    explicit pImpl(GenerationOptions options);
     ~pImpl();
 
     bool update();
@@ -23,21 +41,109 @@ public:
     void createTest(const ExecutableParameters& test,
                     std::filesystem::path project_root);
 
+    void createBenchmark(const ExecutableParameters& benchmark,
+                         std::filesystem::path project_root);
+
+    std::vector<ComponentTiming>
+    createBatch(const BatchParameters& batch,
+                std::filesystem::path project_root);
+
+    bool upgrade(const std::filesystem::path& project_root);
+
 private:
-    bool downloadTemplate();
+    enum class DownloadStatus { Failed, NotModified, Downloaded };
+
+    // A component whose files are being rendered by the thread pool
+    struct PendingComponent {
+        PendingComponent(std::string component_name,
+                         std::filesystem::path root,
+                         std::map<std::string, std::string> values,
+                         SubstitutionEngine engine)
+            : name{std::move(component_name)},
+              template_root{std::move(root)},
+              dictionnary{std::move(values)},
+              replacer{dictionnary, engine} {
+        }
+
+        std::string name;
+        std::filesystem::path template_root;
+        std::map<std::string, std::string> dictionnary;
+        PatternReplacer replacer;
+        std::filesystem::path destination;
+        std::atomic<std::size_t> files{0};
+        std::atomic<std::int64_t> render_time_ns{0};
+
+        // Files written, by target path, to be recorded in the project marker
+        std::mutex generated_mutex;
+        std::vector<std::pair<std::filesystem::path,
+                              ProjectMarker::GeneratedFile>>
+            generated;
+    };
+
+    // Memory used to stream the templates from curl to libarchive
+    static constexpr std::size_t stream_buffer_size = 1 << 20;
+    static constexpr std::size_t stream_chunk_size = 64 << 10;
+
+    void initCurl();
+    DownloadStatus downloadTemplate();
+    DownloadStatus streamTemplate();
     bool extractTemplate();
+    // Extracts the templates to the staging directory, removed on failure
+    bool extractArchive(struct archive* a);
+    // Replaces the templates with the staged ones
+    bool installStagedTemplates();
+
+    void renderTemplate(std::string name,
+                        const std::filesystem::path& template_root,
+                        const std::filesystem::path& destination,
+                        std::map<std::string, std::string> dictionnary);
+
+    // Creates the component directories and submits its files to the thread
+    // pool. Files already in targets are skipped
+    void queueComponent(PendingComponent& component,
+                        const std::filesystem::path& destination,
+                        std::set<std::filesystem::path>& targets);
 
-    void createExecutableOrTest(const ExecutableParameters& test,
-                                std::filesystem::path project_root,
-                                std::filesystem::path template_root);
+    const std::vector<TemplateEntry>&
+    templateEntries(const std::filesystem::path& template_root);
 
-    void searchAndReplace(std::filesystem::path root,
-                          std::map<std::string, std::string> dictionnary) const;
+    // Flushes the output sink and, for a dry run, prints the generated tree
+    void finishGeneration();
+
+    // Adds the generated components and files to the marker of the projects
+    // they were generated in, so that they can be upgraded later
+    void recordGeneration(const std::deque<PendingComponent>& components);
+
+    // To be called before locking the templates for reading, since the
+    // update locks them for writing
+    void downloadMissingTemplates();
+    const TemplateSource& templateSource();
+    const TemplateIndex& templateIndex();
+    // Identifies the templates the index was built from
+    std::uint64_t templatesHash() const;
+    bool buildTemplateIndex();
+    ThreadPool& threadPool();
+    OutputSink& outputSink();
 
     std::string templateUrl() const;
     std::filesystem::path templateArchivePath() const;
-    std::filesystem::path configRootPath() const;
+    const std::filesystem::path& configRootPath() const;
+    void createConfigRoot() const;
+    void removeStaleTemplates() const;
+    std::filesystem::path templateLockPath() const;
     std::filesystem::path templateRootPath() const;
+    std::filesystem::path stagingRootPath() const;
+    std::filesystem::path templateIndexPath() const;
+
+    GenerationOptions options_;
+    mutable std::filesystem::path config_root_;
+    bool curl_initialized_{false};
+    std::unique_ptr<TemplateSource> template_source_;
+    std::unique_ptr<TemplateIndex> template_index_;
+    std::map<std::filesystem::path, std::vector<TemplateEntry>>
+        template_entries_;
+    std::unique_ptr<ThreadPool> thread_pool_;
+    std::unique_ptr<OutputSink> output_sink_;
 };
 
 } // namespace cpgen
\ No newline at end of file
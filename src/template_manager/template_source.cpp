@@ -0,0 +1,178 @@
+#include "template_source.h"
+
+#include <archive.h>
+#include <archive_entry.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+
+namespace cpgen {
+
+DirectoryTemplateSource::DirectoryTemplateSource(
+    std::filesystem::path templates_root)
+    : templates_root_{std::move(templates_root)} {
+}
+
+std::vector<TemplateEntry>
+DirectoryTemplateSource::entries(const std::filesystem::path& root) const {
+    namespace fs = std::filesystem;
+
+    const auto base = root.empty() ? templates_root_ : templates_root_ / root;
+
+    std::vector<TemplateEntry> entries;
+    for (auto& entry : fs::recursive_directory_iterator(base)) {
+        if (not entry.is_directory() and not entry.is_regular_file()) {
+            continue;
+        }
+        entries.push_back(TemplateEntry{
+            entry.path().lexically_relative(base), entry.is_directory(),
+            entry.symlink_status().permissions()});
+    }
+
+    std::sort(begin(entries), end(entries),
+              [](const auto& a, const auto& b) { return a.path < b.path; });
+
+    return entries;
+}
+
+std::string
+DirectoryTemplateSource::content(const std::filesystem::path& root,
+                                 const TemplateEntry& entry) const {
+    const auto path = templates_root_ / root / entry.path;
+
+    std::string content;
+    std::ifstream input(path.native(), std::ios::binary);
+    input.seekg(0, std::ios::end);
+    const auto size = input.tellg();
+    if (size > 0) {
+        content.resize(static_cast<std::size_t>(size));
+        input.seekg(0, std::ios::beg);
+        input.read(content.data(), size);
+    }
+    if (not input or size < 0) {
+        throw std::runtime_error(
+            fmt::format("Failed to read the template {}", path.native()));
+    }
+    return content;
+}
+
+std::optional<std::filesystem::path>
+DirectoryTemplateSource::file(const std::filesystem::path& root,
+                              const TemplateEntry& entry) const {
+    return templates_root_ / root / entry.path;
+}
+
+ArchiveTemplateSource::ArchiveTemplateSource(
+    const std::filesystem::path& archive) {
+    namespace fs = std::filesystem;
+
+    std::unique_ptr<struct archive, decltype(&archive_read_free)> reader{
+        archive_read_new(), &archive_read_free};
+    archive_read_support_format_tar(reader.get());
+    archive_read_support_filter_gzip(reader.get());
+
+    if (archive_read_open_filename(reader.get(), archive.c_str(), 10240) !=
+        ARCHIVE_OK) {
+        throw std::runtime_error(
+            fmt::format("archive_read_open_filename(): {}",
+                        archive_error_string(reader.get())));
+    }
+
+    struct archive_entry* entry;
+    for (;;) {
+        const auto r = archive_read_next_header(reader.get(), &entry);
+        if (r == ARCHIVE_EOF) {
+            break;
+        }
+        if (r != ARCHIVE_OK) {
+            throw std::runtime_error(
+                fmt::format("archive_read_next_header(): {}",
+                            archive_error_string(reader.get())));
+        }
+
+        // Drop the leading templates/ folder
+        const auto full_path =
+            fs::path{archive_entry_pathname(entry)}.lexically_normal();
+        if (full_path.begin() == full_path.end() or
+            *full_path.begin() != "templates") {
+            continue;
+        }
+        const auto path = full_path.lexically_relative("templates");
+        if (path.empty() or path == "." or path.filename().empty()) {
+            continue;
+        }
+
+        const auto permissions =
+            static_cast<fs::perms>(archive_entry_perm(entry)) & fs::perms::mask;
+
+        switch (archive_entry_filetype(entry)) {
+        case AE_IFDIR:
+            addDirectories(path);
+            break;
+        case AE_IFREG: {
+            addDirectories(path.parent_path());
+            auto& file = entries_[path.generic_string()];
+            file.permissions = permissions;
+            file.content.resize(
+                static_cast<std::size_t>(archive_entry_size(entry)));
+            std::size_t offset{0};
+            while (offset < file.content.size()) {
+                const auto read = archive_read_data(
+                    reader.get(), file.content.data() + offset,
+                    file.content.size() - offset);
+                if (read < 0) {
+                    throw std::runtime_error(
+                        fmt::format("archive_read_data(): {}",
+                                    archive_error_string(reader.get())));
+                } else if (read == 0) {
+                    break;
+                }
+                offset += static_cast<std::size_t>(read);
+            }
+            file.content.resize(offset);
+        } break;
+        default:
+            break;
+        }
+    }
+}
+
+std::vector<TemplateEntry>
+ArchiveTemplateSource::entries(const std::filesystem::path& root) const {
+    // Keys below root are contiguous and already sorted so that directories
+    // come before their content
+    const auto prefix = root.empty() ? std::string{}
+                                     : root.generic_string() + "/";
+
+    std::vector<TemplateEntry> entries;
+    for (auto it = entries_.lower_bound(prefix); it != end(entries_); ++it) {
+        const auto& [path, entry] = *it;
+        if (path.compare(0, prefix.size(), prefix) != 0) {
+            break;
+        }
+        entries.push_back(TemplateEntry{path.substr(prefix.size()),
+                                        entry.is_directory, entry.permissions});
+    }
+    return entries;
+}
+
+std::string ArchiveTemplateSource::content(const std::filesystem::path& root,
+                                           const TemplateEntry& entry) const {
+    return entries_.at((root / entry.path).generic_string()).content;
+}
+
+void ArchiveTemplateSource::addDirectories(std::filesystem::path path) {
+    for (; not path.empty(); path = path.parent_path()) {
+        const auto inserted =
+            entries_.try_emplace(path.generic_string(), Entry{true, {}, {}})
+                .second;
+        if (not inserted) {
+            break;
+        }
+    }
+}
+
+} // namespace cpgen
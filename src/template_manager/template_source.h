@@ -0,0 +1,95 @@
+#pragma once
+
+#include "pattern_replacer.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace cpgen {
+
+struct TemplateEntry {
+    // Relative to the component template root (e.g library/static_shared)
+    std::filesystem::path path;
+    bool is_directory{false};
+    std::filesystem::perms permissions{std::filesystem::perms::unknown};
+    // Potential placeholders in the path and in the content, only known when
+    // the entry comes from a TemplateIndex
+    std::optional<std::vector<Placeholder>> path_placeholders{};
+    std::optional<std::vector<Placeholder>> placeholders{};
+    // FNV-1a hash of the file content, also only known when the entry comes
+    // from a TemplateIndex
+    std::uint64_t content_hash{};
+};
+
+// Provides the entries of the component templates and their content
+class TemplateSource {
+public:
+    virtual ~TemplateSource() = default;
+
+    // Lists all the entries below root, sorted so that directories come
+    // before their content. An empty root lists all the templates
+    virtual std::vector<TemplateEntry>
+    entries(const std::filesystem::path& root) const = 0;
+
+    // Throws if the content cannot be read
+    virtual std::string content(const std::filesystem::path& root,
+                                const TemplateEntry& entry) const = 0;
+
+    // The file holding the entry content, if any, so that it can be copied
+    // without being read
+    virtual std::optional<std::filesystem::path>
+    file(const std::filesystem::path& /*root*/,
+         const TemplateEntry& /*entry*/) const {
+        return std::nullopt;
+    }
+};
+
+// Reads the templates extracted in a directory
+class DirectoryTemplateSource : public TemplateSource {
+public:
+    explicit DirectoryTemplateSource(std::filesystem::path templates_root);
+
+    std::vector<TemplateEntry>
+    entries(const std::filesystem::path& root) const override;
+
+    std::string content(const std::filesystem::path& root,
+                        const TemplateEntry& entry) const override;
+
+    std::optional<std::filesystem::path>
+    file(const std::filesystem::path& root,
+         const TemplateEntry& entry) const override;
+
+private:
+    std::filesystem::path templates_root_;
+};
+
+// Loads the whole templates archive in memory so that no extraction is needed
+class ArchiveTemplateSource : public TemplateSource {
+public:
+    // Throws std::runtime_error if the archive cannot be read
+    explicit ArchiveTemplateSource(const std::filesystem::path& archive);
+
+    std::vector<TemplateEntry>
+    entries(const std::filesystem::path& root) const override;
+
+    std::string content(const std::filesystem::path& root,
+                        const TemplateEntry& entry) const override;
+
+private:
+    struct Entry {
+        bool is_directory{false};
+        std::filesystem::perms permissions{std::filesystem::perms::unknown};
+        std::string content;
+    };
+
+    void addDirectories(std::filesystem::path path);
+
+    // Generic paths relative to the archive templates/ folder
+    std::map<std::string, Entry> entries_;
+};
+
+} // namespace cpgen
@@ -0,0 +1,153 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+// Identifies the pool and queue of the current thread so that tasks submitted
+// from a worker go to its own queue
+thread_local const void* current_pool{nullptr};
+thread_local std::size_t current_queue{0};
+
+} // namespace
+
+namespace cpgen {
+
+ThreadPool::ThreadPool(std::size_t threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (threads < 2) {
+        return;
+    }
+
+    queues_.reserve(threads);
+    for (std::size_t i = 0; i < threads; i++) {
+        queues_.emplace_back(std::make_unique<Queue>());
+    }
+    workers_.reserve(threads);
+    for (std::size_t i = 0; i < threads; i++) {
+        workers_.emplace_back([this, i] { workerLoop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock{mutex_};
+        stop_ = true;
+    }
+    task_available_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    if (workers_.empty()) {
+        execute(task);
+        return;
+    }
+
+    std::size_t index{};
+    {
+        std::lock_guard lock{mutex_};
+        if (current_pool == this) {
+            index = current_queue;
+        } else {
+            index = next_queue_;
+            next_queue_ = (next_queue_ + 1) % queues_.size();
+        }
+        ++pending_;
+        ++queued_;
+    }
+
+    {
+        auto& queue = *queues_[index];
+        std::lock_guard lock{queue.mutex};
+        queue.tasks.emplace_back(std::move(task));
+    }
+
+    task_available_.notify_one();
+}
+
+void ThreadPool::wait() {
+    {
+        std::unique_lock lock{mutex_};
+        all_done_.wait(lock, [this] { return pending_ == 0; });
+    }
+
+    if (error_) {
+        std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+}
+
+std::size_t ThreadPool::threadCount() const {
+    return std::max<std::size_t>(1, workers_.size());
+}
+
+void ThreadPool::workerLoop(std::size_t index) {
+    current_pool = this;
+    current_queue = index;
+
+    std::function<void()> task;
+    for (;;) {
+        if (popTask(index, task) or stealTask(index, task)) {
+            {
+                std::lock_guard lock{mutex_};
+                --queued_;
+            }
+            execute(task);
+            task = nullptr;
+
+            std::lock_guard lock{mutex_};
+            if (--pending_ == 0) {
+                all_done_.notify_all();
+            }
+        } else {
+            std::unique_lock lock{mutex_};
+            task_available_.wait(lock,
+                                 [this] { return stop_ or queued_ > 0; });
+            if (stop_) {
+                return;
+            }
+        }
+    }
+}
+
+bool ThreadPool::popTask(std::size_t index, std::function<void()>& task) {
+    auto& queue = *queues_[index];
+    std::lock_guard lock{queue.mutex};
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::stealTask(std::size_t index, std::function<void()>& task) {
+    for (std::size_t i = 1; i < queues_.size(); i++) {
+        auto& queue = *queues_[(index + i) % queues_.size()];
+        std::lock_guard lock{queue.mutex};
+        if (not queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::execute(std::function<void()>& task) {
+    try {
+        task();
+    } catch (...) {
+        std::lock_guard lock{mutex_};
+        if (not error_) {
+            error_ = std::current_exception();
+        }
+    }
+}
+
+} // namespace cpgen
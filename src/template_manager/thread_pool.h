@@ -0,0 +1,62 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cpgen {
+
+// Work-stealing thread pool. Each worker owns a task queue, pushes the tasks
+// it submits to it and pops them in LIFO order, while idle workers steal the
+// oldest tasks of the other queues. Tasks can submit new tasks, which makes
+// recursive tree walks spread naturally across the workers.
+// With less than two threads no worker is started and tasks are executed
+// directly inside submit()
+class ThreadPool {
+public:
+    // A thread count of zero uses all the available hardware threads
+    explicit ThreadPool(std::size_t threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> task);
+
+    // Waits for all submitted tasks, including the ones they submitted, to
+    // complete. Rethrows the first exception thrown by a task, if any
+    void wait();
+
+    std::size_t threadCount() const;
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void workerLoop(std::size_t index);
+    bool popTask(std::size_t index, std::function<void()>& task);
+    bool stealTask(std::size_t index, std::function<void()>& task);
+    void execute(std::function<void()>& task);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> workers_;
+
+    std::mutex mutex_;
+    std::condition_variable task_available_;
+    std::condition_variable all_done_;
+    std::size_t queued_{};
+    std::size_t pending_{};
+    std::size_t next_queue_{};
+    bool stop_{false};
+    std::exception_ptr error_;
+};
+
+} // namespace cpgen
@@ -0,0 +1,125 @@
+#include <cpgen/trace.h>
+
+#include <fmt/format.h>
+
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <unistd.h>
+
+namespace {
+
+std::atomic<cpgen::Tracer*> active_tracer{nullptr};
+
+// Small ids are easier to read than the native thread ids in the viewers
+std::uint32_t thread_id() {
+    static std::atomic<std::uint32_t> next_id{0};
+    thread_local const std::uint32_t id = next_id++;
+    return id;
+}
+
+std::string escape(std::string_view input) {
+    std::string output;
+    output.reserve(input.size());
+    for (const char c : input) {
+        switch (c) {
+        case '"':
+            output += "\\\"";
+            break;
+        case '\\':
+            output += "\\\\";
+            break;
+        case '\n':
+            output += "\\n";
+            break;
+        case '\t':
+            output += "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                output += fmt::format("\\u{:04x}", static_cast<int>(c));
+            } else {
+                output += c;
+            }
+        }
+    }
+    return output;
+}
+
+} // namespace
+
+namespace cpgen {
+
+class Tracer::pImpl {
+public:
+    explicit pImpl(std::filesystem::path file)
+        : file_{std::move(file)}, origin_{clock::now()} {
+    }
+
+    void addSpan(std::string_view category, std::string_view name,
+                 clock::time_point start, clock::time_point end,
+                 const Args& args) {
+        // Complete events, with timestamps and durations in microseconds
+        auto event = fmt::format(
+            R"({{"name":"{}","cat":"{}","ph":"X","ts":{:.3f},"dur":{:.3f},)"
+            R"("pid":{},"tid":{})",
+            escape(name), escape(category), to_us(start - origin_),
+            to_us(end - start), getpid(), thread_id());
+        if (not args.empty()) {
+            event += R"(,"args":{)";
+            for (std::size_t i = 0; i < args.size(); i++) {
+                event += fmt::format(R"({}"{}":{})", i > 0 ? "," : "",
+                                     escape(args[i].first), args[i].second);
+            }
+            event += '}';
+        }
+        event += '}';
+
+        std::lock_guard lock{mutex_};
+        events_.push_back(std::move(event));
+    }
+
+    void write() const {
+        auto file = std::fopen(file_.c_str(), "w");
+        if (file == nullptr) {
+            fmt::print(stderr, "Failed to open {} to write the trace\n",
+                       file_.native());
+            return;
+        }
+        fmt::print(file, "{{\"traceEvents\":[\n{}\n]}}\n",
+                   fmt::join(events_, ",\n"));
+        std::fclose(file);
+    }
+
+private:
+    static double to_us(clock::duration duration) {
+        return std::chrono::duration<double, std::micro>(duration).count();
+    }
+
+    std::filesystem::path file_;
+    clock::time_point origin_;
+    std::mutex mutex_;
+    std::vector<std::string> events_;
+};
+
+Tracer::Tracer(std::filesystem::path file)
+    : impl_{std::make_unique<pImpl>(std::move(file))} {
+    active_tracer = this;
+}
+
+Tracer::~Tracer() {
+    active_tracer = nullptr;
+    impl_->write();
+}
+
+Tracer* Tracer::active() {
+    return active_tracer.load(std::memory_order_relaxed);
+}
+
+void Tracer::addSpan(std::string_view category, std::string_view name,
+                     clock::time_point start, clock::time_point end,
+                     Args args) {
+    impl_->addSpan(category, name, start, end, args);
+}
+
+} // namespace cpgen
@@ -0,0 +1,136 @@
+#include "pattern_replacer.h"
+
+#include <catch2/catch.hpp>
+
+#include <map>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using cpgen::PatternReplacer;
+using cpgen::SubstitutionEngine;
+
+const auto dictionnary = std::map<std::string, std::string>{
+    {"component_name", "greeter"},
+    {"component_std", "17"},
+    {"component_dependencies", "CONAN_PKG::fmt\n\t\tThreads::Threads"},
+    {"name", "N"}};
+
+std::optional<std::string> scanner(std::string_view input) {
+    return PatternReplacer{dictionnary, SubstitutionEngine::Scanner}.replace(
+        input);
+}
+
+std::optional<std::string> regex(std::string_view input) {
+    return PatternReplacer{dictionnary, SubstitutionEngine::Regex}.replace(
+        input);
+}
+
+// Replacement using the placeholders found beforehand, as done with the
+// template index
+std::optional<std::string> indexed(std::string_view input) {
+    return PatternReplacer{dictionnary, SubstitutionEngine::Scanner}.replace(
+        input, PatternReplacer::findPlaceholders(input));
+}
+
+} // namespace
+
+TEST_CASE("Inputs without placeholders are left untouched") {
+    for (const auto input :
+         {"", "int main() {}", "__", "____", "a__b", "__unknown_key__"}) {
+        CHECK_FALSE(scanner(input));
+        CHECK_FALSE(indexed(input));
+    }
+    CHECK_FALSE(regex("int main() {}"));
+}
+
+TEST_CASE("All engines agree on regular templates") {
+    const auto input = std::string_view{
+        "add_library(__component_name__ STATIC ${__component_name___FILES})\n"
+        "target_compile_features(__component_name__ PUBLIC "
+        "cxx_std___component_std__)\n"
+        "target_link_libraries(__component_name__ PUBLIC "
+        "__component_dependencies__)\n"
+        "# __unknown__ and __not a key__ stay as is\n"};
+
+    const auto expected = std::string{
+        "add_library(greeter STATIC ${greeter_FILES})\n"
+        "target_compile_features(greeter PUBLIC cxx_std_17)\n"
+        "target_link_libraries(greeter PUBLIC CONAN_PKG::fmt\n"
+        "\t\tThreads::Threads)\n"
+        "# __unknown__ and __not a key__ stay as is\n"};
+
+    CHECK(scanner(input) == expected);
+    CHECK(regex(input) == expected);
+    CHECK(indexed(input) == expected);
+}
+
+TEST_CASE("Paths are substituted") {
+    const auto input =
+        std::string_view{"include/__component_name__/__component_name__.h"};
+    const auto expected = std::string{"include/greeter/greeter.h"};
+
+    CHECK(scanner(input) == expected);
+    CHECK(regex(input) == expected);
+    CHECK(indexed(input) == expected);
+}
+
+TEST_CASE("Values are inserted literally by the scanner") {
+    const auto values = std::map<std::string, std::string>{{"key", "$&-$1"}};
+    const PatternReplacer scanner{values, SubstitutionEngine::Scanner};
+    const PatternReplacer regex{values, SubstitutionEngine::Regex};
+
+    CHECK(scanner.replace("a __key__ b") == "a $&-$1 b");
+    CHECK(regex.replace("a __key__ b") == "a __key__- b");
+}
+
+TEST_CASE("Overlapping placeholders are substituted leftmost first") {
+    const auto input = std::string_view{"___name__component_name__"};
+
+    CHECK(scanner(input) == "_Ncomponent_name__");
+    CHECK(indexed(input) == "_Ncomponent_name__");
+    // Each key is substituted in turn over the whole buffer
+    CHECK(regex(input) == "___namegreeter");
+}
+
+TEST_CASE("Stale placeholders fall back to a full scan") {
+    const auto input = std::string_view{"__name__ and __component_std__"};
+    const PatternReplacer replacer{dictionnary, SubstitutionEngine::Scanner};
+
+    const auto stale = PatternReplacer::findPlaceholders("x__name__");
+    CHECK(replacer.replace(input, stale) == scanner(input));
+    CHECK(replacer.replace(input, {}) == std::nullopt);
+}
+
+TEST_CASE("Dictionnaries with invalid keys fall back to a full scan") {
+    const auto values =
+        std::map<std::string, std::string>{{"not a key", "value"}};
+    const PatternReplacer replacer{values, SubstitutionEngine::Scanner};
+    const auto input = std::string_view{"__not a key__"};
+
+    CHECK(replacer.replace(input) == "value");
+    CHECK(replacer.replace(input, PatternReplacer::findPlaceholders(input)) ==
+          "value");
+    CHECK_FALSE(replacer.isVerbatim({}));
+}
+
+TEST_CASE("Indexed replacement matches the scanner on random inputs") {
+    // Small alphabet so that delimiters, keys and overlaps are frequent
+    const std::string alphabet{"_namecompt N"};
+    std::mt19937 generator{42};
+    std::uniform_int_distribution<std::size_t> character(0,
+                                                         alphabet.size() - 1);
+    std::uniform_int_distribution<std::size_t> length(0, 64);
+
+    for (int i = 0; i < 10000; i++) {
+        std::string input(length(generator), ' ');
+        for (auto& c : input) {
+            c = alphabet[character(generator)];
+        }
+        INFO(input);
+        REQUIRE(indexed(input) == scanner(input));
+    }
+}
@@ -0,0 +1,89 @@
+#include "project_marker.h"
+#include "temporary_directory.h"
+
+#include <catch2/catch.hpp>
+
+#include <string>
+
+namespace {
+
+using cpgen::ProjectMarker;
+
+ProjectMarker sample_marker() {
+    ProjectMarker marker;
+    marker.components["library greeter"] = ProjectMarker::Component{
+        "library/static_shared",
+        {{"component_name", "greeter"},
+         {"component_dependencies", "CONAN_PKG::fmt\n\t\tThreads::Threads"},
+         {"component_pch", "\"<vector>\" \"\\\\server\\\\header.h\""},
+         {"empty", ""}}};
+    marker.components["project demo"] =
+        ProjectMarker::Component{"project", {{"project_name", "demo"}}};
+    marker.files["src/greeter/CMakeLists.txt"] = ProjectMarker::GeneratedFile{
+        "library greeter", "src/__component_name__/CMakeLists.txt",
+        0x0123456789abcdefull, 0xfedcba9876543210ull};
+    marker.files["dir with\ttab/file"] = ProjectMarker::GeneratedFile{
+        "project demo", "dir with\ttab/file", 0, 1};
+    return marker;
+}
+
+} // namespace
+
+TEST_CASE("The project marker can be saved and loaded back") {
+    TemporaryDirectory project;
+    const auto file = ProjectMarker::path(project.path());
+    CHECK(file == project.path() / ".cpgen");
+
+    const auto marker = sample_marker();
+    REQUIRE(marker.save(file));
+
+    const auto loaded = ProjectMarker::load(file);
+    REQUIRE(loaded);
+
+    REQUIRE(loaded->components.size() == marker.components.size());
+    for (const auto& [name, component] : marker.components) {
+        INFO(name);
+        REQUIRE(loaded->components.contains(name));
+        CHECK(loaded->components.at(name).template_root ==
+              component.template_root);
+        CHECK(loaded->components.at(name).dictionnary ==
+              component.dictionnary);
+    }
+
+    REQUIRE(loaded->files.size() == marker.files.size());
+    for (const auto& [path, generated] : marker.files) {
+        INFO(path);
+        REQUIRE(loaded->files.contains(path));
+        const auto& loaded_file = loaded->files.at(path);
+        CHECK(loaded_file.component == generated.component);
+        CHECK(loaded_file.entry == generated.entry);
+        CHECK(loaded_file.template_hash == generated.template_hash);
+        CHECK(loaded_file.content_hash == generated.content_hash);
+    }
+}
+
+TEST_CASE("An empty project marker gives an empty ProjectMarker") {
+    TemporaryDirectory project;
+    project.write(".cpgen", "");
+
+    const auto marker = ProjectMarker::load(project.path() / ".cpgen");
+    REQUIRE(marker);
+    CHECK(marker->components.empty());
+    CHECK(marker->files.empty());
+}
+
+TEST_CASE("Invalid project markers are rejected") {
+    TemporaryDirectory project;
+    const auto file = project.path() / ".cpgen";
+
+    CHECK_FALSE(ProjectMarker::load(file));
+
+    project.write(".cpgen", "cpgen\t999\n");
+    CHECK_FALSE(ProjectMarker::load(file));
+
+    project.write(".cpgen", "cpgen\t1\nunknown\trecord\n");
+    CHECK_FALSE(ProjectMarker::load(file));
+
+    project.write(".cpgen", "cpgen\t1\nfile\ta\tb\tc\tnot_a_hash\t0\n");
+    CHECK_FALSE(ProjectMarker::load(file));
+}
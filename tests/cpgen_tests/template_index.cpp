@@ -0,0 +1,151 @@
+#include "template_index.h"
+#include "temporary_directory.h"
+
+#include <catch2/catch.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using cpgen::DirectoryTemplateSource;
+using cpgen::TemplateEntry;
+using cpgen::TemplateIndex;
+
+void write_templates(const TemporaryDirectory& templates) {
+    templates.write("project/CMakeLists.txt", "project(__project_name__)\n");
+    templates.write("project/LICENSE", "No placeholder here\n");
+    templates.write("library/src/__component_name__/__component_name__.cpp",
+                    "#include <__component_name__/__component_name__.h>\n");
+    templates.write("library/src/__component_name__/empty.cpp", "");
+}
+
+void check_same_entries(const std::vector<TemplateEntry>& entries,
+                        const std::vector<TemplateEntry>& expected) {
+    REQUIRE(entries.size() == expected.size());
+    for (std::size_t i = 0; i < entries.size(); i++) {
+        const auto& entry = entries[i];
+        const auto& other = expected[i];
+        INFO(other.path);
+        CHECK(entry.path == other.path);
+        CHECK(entry.is_directory == other.is_directory);
+        CHECK(entry.permissions == other.permissions);
+        CHECK(entry.content_hash == other.content_hash);
+
+        REQUIRE(entry.path_placeholders.has_value());
+        REQUIRE(entry.path_placeholders->size() ==
+                other.path_placeholders->size());
+        for (std::size_t j = 0; j < entry.path_placeholders->size(); j++) {
+            CHECK((*entry.path_placeholders)[j].offset ==
+                  (*other.path_placeholders)[j].offset);
+            CHECK((*entry.path_placeholders)[j].key_length ==
+                  (*other.path_placeholders)[j].key_length);
+        }
+
+        REQUIRE(entry.placeholders.has_value() ==
+                other.placeholders.has_value());
+        if (entry.placeholders) {
+            REQUIRE(entry.placeholders->size() == other.placeholders->size());
+            for (std::size_t j = 0; j < entry.placeholders->size(); j++) {
+                CHECK((*entry.placeholders)[j].offset ==
+                      (*other.placeholders)[j].offset);
+                CHECK((*entry.placeholders)[j].key_length ==
+                      (*other.placeholders)[j].key_length);
+            }
+        }
+    }
+}
+
+} // namespace
+
+TEST_CASE("The template index describes all the templates") {
+    TemporaryDirectory templates;
+    write_templates(templates);
+
+    const DirectoryTemplateSource source{templates.path()};
+    const auto index = TemplateIndex::build(source, 42);
+
+    const auto entries = index.entries("library");
+    REQUIRE(entries.size() == 4);
+    CHECK(entries[0].path == "src");
+    CHECK(entries[0].is_directory);
+
+    // The path placeholders are relative to the component template root
+    const auto& file = entries[2];
+    CHECK(file.path == "src/__component_name__/__component_name__.cpp");
+    REQUIRE(file.path_placeholders->size() == 2);
+    CHECK((*file.path_placeholders)[0].offset == 4);
+    CHECK((*file.path_placeholders)[0].key_length == 14);
+    CHECK(file.placeholders->size() == 2);
+    CHECK(file.content_hash ==
+          TemplateIndex::hash(
+              "#include <__component_name__/__component_name__.h>\n"));
+
+    const auto& empty = entries[3];
+    CHECK(empty.placeholders->empty());
+    CHECK(empty.content_hash == TemplateIndex::hash(""));
+}
+
+TEST_CASE("The template index can be saved and loaded back") {
+    TemporaryDirectory templates;
+    write_templates(templates);
+    TemporaryDirectory output;
+    const auto file = output.path() / "templates.index";
+
+    const DirectoryTemplateSource source{templates.path()};
+    const auto index = TemplateIndex::build(source, 42);
+    REQUIRE(index.save(file));
+
+    SECTION("With the same templates hash") {
+        const auto loaded = TemplateIndex::load(file, 42);
+        REQUIRE(loaded);
+        check_same_entries(loaded->entries({}), index.entries({}));
+        check_same_entries(loaded->entries("library"),
+                           index.entries("library"));
+    }
+
+    SECTION("With another templates hash") {
+        CHECK_FALSE(TemplateIndex::load(file, 43));
+    }
+
+    SECTION("Truncated") {
+        std::filesystem::resize_file(file,
+                                     std::filesystem::file_size(file) - 1);
+        CHECK_FALSE(TemplateIndex::load(file, 42));
+    }
+
+    SECTION("Missing") {
+        CHECK_FALSE(TemplateIndex::load(output.path() / "missing", 42));
+    }
+}
+
+TEST_CASE("The directory hash changes with the templates") {
+    TemporaryDirectory templates;
+    write_templates(templates);
+
+    const auto hash = TemplateIndex::hashDirectory(templates.path());
+    CHECK(hash != 0);
+    CHECK(TemplateIndex::hashDirectory(templates.path()) == hash);
+
+    SECTION("When a file is added") {
+        templates.write("project/README.md", "__project_name__\n");
+        CHECK(TemplateIndex::hashDirectory(templates.path()) != hash);
+    }
+
+    SECTION("When a file is edited") {
+        templates.write("project/LICENSE", "A __project_name__ placeholder\n");
+        CHECK(TemplateIndex::hashDirectory(templates.path()) != hash);
+    }
+
+    SECTION("When a file is removed") {
+        std::filesystem::remove(templates.path() / "project/LICENSE");
+        CHECK(TemplateIndex::hashDirectory(templates.path()) != hash);
+    }
+
+    SECTION("Unless the directory cannot be listed") {
+        CHECK(TemplateIndex::hashDirectory(templates.path() / "missing") ==
+              0);
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <unistd.h>
+
+// Unique directory removed with its content on destruction
+class TemporaryDirectory {
+public:
+    TemporaryDirectory() {
+        static std::atomic<int> count{0};
+        path_ = std::filesystem::temp_directory_path() /
+                fmt::format("cpgen_tests.{}.{}", getpid(), count++);
+        std::filesystem::create_directories(path_);
+    }
+
+    TemporaryDirectory(const TemporaryDirectory&) = delete;
+    TemporaryDirectory& operator=(const TemporaryDirectory&) = delete;
+
+    ~TemporaryDirectory() {
+        std::error_code error;
+        std::filesystem::remove_all(path_, error);
+    }
+
+    const std::filesystem::path& path() const {
+        return path_;
+    }
+
+    // Creates the file and its parent directories
+    void write(const std::filesystem::path& file,
+               std::string_view content) const {
+        std::filesystem::create_directories((path_ / file).parent_path());
+        std::ofstream output((path_ / file).native(), std::ios::binary);
+        output << content;
+    }
+
+private:
+    std::filesystem::path path_;
+};